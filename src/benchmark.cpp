@@ -0,0 +1,411 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "dijkstra.hpp"
+#include "dijkstra_rank.hpp"
+#include "enumerate_optimals.hpp"
+#include "graph_loading.hpp"
+#include "grid.hpp"
+#include "webUtilities.hpp"
+
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+
+namespace po = boost::program_options;
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+  uint64_t seed;
+  size_t queries;
+  size_t enumerateQueries;
+  size_t maxRoutes;
+  size_t rankSources;
+  std::string rankQueries;
+  std::string writeRankQueries;
+};
+
+// Timings of single operations in nanoseconds and counters reported along
+// with them, e.g. the priority queue pops of each query.
+struct Samples {
+  std::vector<uint64_t> ns;
+  std::map<std::string, std::vector<double>> counters;
+
+  template <class F> auto measure(F f)
+  {
+    auto start = Clock::now();
+    auto result = f();
+    auto end = Clock::now();
+    ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    return result;
+  }
+};
+
+// Nearest-rank percentile of sorted values.
+template <class T> T percentile(const std::vector<T>& sorted, double p)
+{
+  const size_t rank = std::ceil(p / 100 * sorted.size());
+  return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+template <class T> Json::Value summarize(std::vector<T> values)
+{
+  Json::Value result;
+  result["count"] = Json::UInt64(values.size());
+  if (values.empty()) {
+    return result;
+  }
+  std::sort(values.begin(), values.end());
+  result["mean"] = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+  result["min"] = values.front();
+  for (double p : { 50, 90, 99 }) {
+    result["p" + std::to_string(static_cast<int>(p))] = percentile(values, p);
+  }
+  result["max"] = values.back();
+  return result;
+}
+
+Json::Value summarize(const Samples& samples)
+{
+  Json::Value result;
+  Json::Value ns = summarize(std::vector<Json::UInt64>(samples.ns.begin(), samples.ns.end()));
+  result["ns"] = ns;
+  for (const auto& [name, values] : samples.counters) {
+    result[name] = summarize(values);
+  }
+  return result;
+}
+
+// Every workload draws from its own generator, so its input only depends on
+// the seed and not on the other workloads run before it.
+std::mt19937_64 generatorFor(const std::string& workload, uint64_t seed)
+{
+  std::vector<uint32_t> values { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) };
+  values.insert(values.end(), workload.begin(), workload.end());
+  std::seed_seq seq(values.begin(), values.end());
+  return std::mt19937_64 { seq };
+}
+
+template <int Dim> struct Query {
+  NodePos from;
+  NodePos to;
+  Config<Dim> config;
+};
+
+template <int Dim>
+Query<Dim> randomQuery(const Graph<Dim>& g, std::mt19937_64& gen)
+{
+  std::uniform_int_distribution<uint32_t> node(0, g.getNodeCount() - 1);
+  NodePos from { node(gen) };
+  NodePos to { node(gen) };
+  return Query<Dim> { from, to, generateRandomConfig<Dim>(gen) };
+}
+
+template <int Dim>
+void runQueries(Graph<Dim>& g, const std::vector<Query<Dim>>& queries, Samples& samples)
+{
+  auto d = g.createDijkstra();
+  for (const auto& q : queries) {
+    auto route = samples.measure([&]() { return d.findBestRoute(q.from, q.to, q.config); });
+    samples.counters["pqPops"].push_back(d.pqPops);
+    samples.counters["settledNodes"].push_back(d.settledNodes);
+    samples.counters["found"].push_back(route ? 1 : 0);
+  }
+}
+
+template <int Dim> Json::Value chRandom(Graph<Dim>& g, const BenchOptions& options)
+{
+  auto gen = generatorFor("ch-random", options.seed);
+  std::vector<Query<Dim>> queries;
+  for (size_t i = 0; i < options.queries; ++i) {
+    queries.push_back(randomQuery(g, gen));
+  }
+  Samples samples;
+  runQueries(g, queries, samples);
+  return summarize(samples);
+}
+
+// Queries grouped by the beeline distance between start and target. Pairs
+// are drawn until every group is full or too many attempts failed.
+template <int Dim> Json::Value chDistance(Graph<Dim>& g, const BenchOptions& options)
+{
+  const std::vector<double> bounds { 1000, 5000, 20000, 80000 };
+  const size_t perGroup = std::max<size_t>(1, options.queries / (bounds.size() + 1));
+  std::vector<std::vector<Query<Dim>>> groups(bounds.size() + 1);
+
+  auto gen = generatorFor("ch-distance", options.seed);
+  size_t full = 0;
+  for (size_t attempt = 0; full < groups.size() && attempt < 100 * options.queries; ++attempt) {
+    auto q = randomQuery(g, gen);
+    const double distance = haversine_distance(g.getNode(q.from), g.getNode(q.to));
+    const size_t group
+        = std::upper_bound(bounds.begin(), bounds.end(), distance) - bounds.begin();
+    if (groups[group].size() < perGroup) {
+      groups[group].push_back(q);
+      full += groups[group].size() == perGroup;
+    }
+  }
+
+  Json::Value result(Json::arrayValue);
+  for (size_t i = 0; i < groups.size(); ++i) {
+    Samples samples;
+    runQueries(g, groups[i], samples);
+    Json::Value group = summarize(samples);
+    group["minDistance"] = i == 0 ? 0.0 : bounds[i - 1];
+    if (i < bounds.size()) {
+      group["maxDistance"] = bounds[i];
+    }
+    result.append(group);
+  }
+  return result;
+}
+
+// Queries grouped by the Dijkstra rank of their target, read from a file or
+// generated from the seed.
+template <int Dim> Json::Value chRank(Graph<Dim>& g, const BenchOptions& options)
+{
+  std::vector<RankQuery<Dim>> queries;
+  if (!options.rankQueries.empty()) {
+    std::ifstream in { options.rankQueries };
+    if (!in) {
+      throw std::runtime_error("Could not open " + options.rankQueries);
+    }
+    queries = readRankQueries<Dim>(in, g.getNodeCount());
+  } else {
+    auto gen = generatorFor("ch-rank", options.seed);
+    queries = dijkstraRankQueries(g, options.rankSources, gen);
+  }
+  if (!options.writeRankQueries.empty()) {
+    std::ofstream out { options.writeRankQueries };
+    writeRankQueries(out, queries);
+  }
+
+  std::map<size_t, std::vector<Query<Dim>>> ranks;
+  for (const auto& q : queries) {
+    ranks[q.rank].push_back(Query<Dim> { q.from, q.to, q.config });
+  }
+  Json::Value result(Json::arrayValue);
+  for (const auto& [rank, group] : ranks) {
+    Samples samples;
+    runQueries(g, group, samples);
+    Json::Value summary = summarize(samples);
+    summary["rank"] = Json::UInt64(rank);
+    result.append(summary);
+  }
+  return result;
+}
+
+// Like cr_expr, only pairs with a route by length are enumerated, so that
+// failing enumerations do not end up in the timings.
+template <int Dim> Json::Value enumerate(Graph<Dim>& g, const BenchOptions& options)
+{
+  auto gen = generatorFor("enumerate", options.seed);
+  auto d = g.createDijkstra();
+  std::vector<double> lengthConfig(Dim, 0);
+  lengthConfig[0] = 1;
+  Samples samples;
+  size_t attempts = 0;
+  for (size_t i = 0; i < options.enumerateQueries; ++i) {
+    auto q = randomQuery(g, gen);
+    while (q.from == q.to || !d.findBestRoute(q.from, q.to, lengthConfig)) {
+      if (++attempts >= 100 * options.enumerateQueries) {
+        throw std::runtime_error("Could not find connected pairs to enumerate");
+      }
+      q = randomQuery(g, gen);
+    }
+    EnumerateOptimals<Dim, SimilarityPrio> o(&g, options.maxRoutes);
+    samples.measure([&]() {
+      o.find(q.from, q.to);
+      return 0;
+    });
+    samples.counters["routes"].push_back(o.found_route_count());
+  }
+  Json::Value result = summarize(samples);
+  result["maxRoutes"] = Json::UInt64(options.maxRoutes);
+  return result;
+}
+
+template <int Dim> Json::Value snap(Graph<Dim>& g, const BenchOptions& options)
+{
+  const auto& grid = g.getGrid();
+  const auto box = grid.bounding_box();
+  auto gen = generatorFor("snap", options.seed);
+  std::uniform_real_distribution<double> lat(box.lat_min, box.lat_max);
+  std::uniform_real_distribution<double> lng(box.lng_min, box.lng_max);
+  std::vector<LatLng> coordinates;
+  for (size_t i = 0; i < options.queries; ++i) {
+    const double latitude = lat(gen);
+    coordinates.push_back(LatLng { Lat { latitude }, Lng { lng(gen) } });
+  }
+
+  Samples single;
+  for (const auto& c : coordinates) {
+    single.measure([&]() { return grid.findNextNode(c.lat, c.lng); });
+  }
+  Samples batch;
+  batch.measure([&]() { return grid.findNextNodes(coordinates); });
+
+  Json::Value result;
+  result["single"] = summarize(single);
+  result["batch"] = summarize(batch);
+  return result;
+}
+
+template <int Dim> Json::Value serialize(Graph<Dim>& g, const BenchOptions& options)
+{
+  auto gen = generatorFor("serialize", options.seed);
+  auto d = g.createDijkstra();
+  std::vector<Route<Dim>> routes;
+  for (size_t i = 0; i < options.queries; ++i) {
+    auto q = randomQuery(g, gen);
+    if (auto route = d.findBestRoute(q.from, q.to, q.config)) {
+      routes.push_back(std::move(*route));
+    }
+  }
+
+  Samples samples;
+  Json::StreamWriterBuilder builder;
+  for (const auto& route : routes) {
+    auto text
+        = samples.measure([&]() { return Json::writeString(builder, routeToJson(route, g)); });
+    samples.counters["edges"].push_back(route.edges.size());
+    samples.counters["bytes"].push_back(text.size());
+  }
+  return summarize(samples);
+}
+
+template <int Dim>
+using Workload = std::function<Json::Value(Graph<Dim>&, const BenchOptions&)>;
+
+template <int Dim> const std::vector<std::pair<std::string, Workload<Dim>>>& workloads()
+{
+  static const std::vector<std::pair<std::string, Workload<Dim>>> all {
+    { "ch-random", chRandom<Dim> },
+    { "ch-distance", chDistance<Dim> },
+    { "ch-rank", chRank<Dim> },
+    { "enumerate", enumerate<Dim> },
+    { "snap", snap<Dim> },
+    { "serialize", serialize<Dim> },
+  };
+  return all;
+}
+
+template <int Dim>
+int run(po::variables_map& vm, std::string& loadFileName, const BenchOptions& options)
+{
+  auto g = vm.count("text") > 0 ? loadGraphFromTextFile<Dim>(loadFileName, vm.count("zi") > 0)
+                                : loadGraphFromBinaryFile<Dim>(loadFileName);
+
+  std::vector<std::string> selected;
+  if (vm.count("workload") > 0) {
+    selected = vm["workload"].as<std::vector<std::string>>();
+  } else {
+    for (const auto& [name, workload] : workloads<Dim>()) {
+      selected.push_back(name);
+    }
+  }
+
+  Json::Value report;
+  report["graph"] = loadFileName;
+  report["dimension"] = Dim;
+  report["nodes"] = Json::UInt64(g.getNodeCount());
+  report["seed"] = Json::UInt64(options.seed);
+  report["queries"] = Json::UInt64(options.queries);
+  for (const auto& name : selected) {
+    auto workload = std::find_if(workloads<Dim>().begin(), workloads<Dim>().end(),
+        [&name](const auto& w) { return w.first == name; });
+    if (workload == workloads<Dim>().end()) {
+      std::cout << "Unknown workload " << name << '\n';
+      return 1;
+    }
+    std::cout << "Running " << name << '\n';
+    report["workloads"][name] = workload->second(g, options);
+  }
+
+  const auto outputFile = vm["output"].as<std::string>();
+  std::ofstream out { outputFile };
+  Json::StreamWriterBuilder builder;
+  out << Json::writeString(builder, report) << '\n';
+  std::cout << "Wrote report to " << outputFile << '\n';
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string loadFileName {};
+  unsigned short dim = 3;
+  BenchOptions options { 1, 1000, 20, 20, 50, "", "" };
+
+  po::options_description loading { "loading options" };
+  // clang-format off
+  loading.add_options()
+    ("text,t", po::value<std::string>(&loadFileName), "load graph from text file")
+    ("bin,b", po::value<std::string>(&loadFileName), "load graph from binary file")
+    ("zi", "input text file is gzipped")
+    ("dimension,d", po::value<unsigned short>(&dim), "Dimension of loaded Graph");
+  // clang-format on
+
+  po::options_description bench { "benchmark options" };
+  // clang-format off
+  bench.add_options()
+    ("workload,w", po::value<std::vector<std::string>>(), "workload to run, may be repeated, runs all by default: ch-random, ch-distance, ch-rank, enumerate, snap, serialize")
+    ("seed", po::value<uint64_t>(&options.seed), "seed of the random inputs")
+    ("queries,q", po::value<size_t>(&options.queries), "queries per workload")
+    ("enumerate-queries", po::value<size_t>(&options.enumerateQueries), "queries of the enumerate workload")
+    ("max-routes", po::value<size_t>(&options.maxRoutes), "maximal routes per enumeration")
+    ("rank-sources", po::value<size_t>(&options.rankSources), "sources of the generated ch-rank queries")
+    ("rank-queries", po::value<std::string>(&options.rankQueries), "read the ch-rank queries from this file instead")
+    ("write-rank-queries", po::value<std::string>(&options.writeRankQueries), "write the ch-rank queries to this file")
+    ("output,o", po::value<std::string>()->default_value("benchmark.json"), "file to write the JSON report to");
+  // clang-format on
+
+  po::options_description all;
+  all.add_options()("help,h", "prints help message");
+  all.add(loading).add(bench);
+
+  po::variables_map vm {};
+  po::store(po::parse_command_line(argc, argv, all), vm);
+  po::notify(vm);
+
+  if (vm.count("help") > 0 || (vm.count("text") == 0 && vm.count("bin") == 0)) {
+    std::cout << all << '\n';
+    return 0;
+  }
+
+  switch (dim) {
+  case 1:
+    return run<1>(vm, loadFileName, options);
+  case 2:
+    return run<2>(vm, loadFileName, options);
+  case 3:
+    return run<3>(vm, loadFileName, options);
+  case 4:
+    return run<4>(vm, loadFileName, options);
+  default:
+    std::cout << "Code is not compiled for Dimension " << dim << '\n';
+    break;
+  }
+  return 1;
+}
@@ -0,0 +1,145 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "contraction.hpp"
+#include "graph_loading.hpp"
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+namespace po = boost::program_options;
+namespace c = std::chrono;
+
+template <int Dim>
+int run(po::variables_map& vm, const std::string& loadFileName, const ContractionOptions& options)
+{
+  const size_t N = 256 * 1024;
+  char buffer[N];
+  std::ifstream graphFile {};
+  graphFile.rdbuf()->pubsetbuf((char*)buffer, N);
+  graphFile.open(loadFileName);
+  if (!graphFile) {
+    std::cout << "Could not open " << loadFileName << '\n';
+    return 1;
+  }
+
+  iostr::filtering_istream in;
+  if (vm.count("zi") > 0) {
+    in.push(iostr::gzip_decompressor());
+  }
+  in.push(graphFile);
+
+  std::cout << "Reading Graphdata" << '\n';
+  auto contraction = Contraction<Dim>::createFromStream(in);
+  const auto nodeCount = contraction.getNodes().size();
+  std::cout << nodeCount << " nodes, " << contraction.getEdges().size() << " edges" << '\n';
+
+  auto start = c::high_resolution_clock::now();
+  size_t done = 0;
+  for (size_t count = contraction.contractRound(options); count > 0;
+       count = contraction.contractRound(options)) {
+    done += count;
+    std::cout << "round " << contraction.getRounds() << ": contracted " << count << " nodes, "
+              << nodeCount - done << " left, " << contraction.getShortcutCount() << " shortcuts"
+              << '\n';
+  }
+  auto end = c::high_resolution_clock::now();
+  std::cout << "contraction took " << c::duration_cast<ms>(end - start).count() << "ms" << '\n';
+
+  if (vm.count("output") > 0) {
+    std::cout << "Writing text graph" << '\n';
+    std::ofstream out { vm["output"].as<std::string>() };
+    contraction.writeText(out);
+  }
+  if (vm.count("save") > 0) {
+    std::cout << "Saving" << '\n';
+    auto g = contraction.createGraph();
+    std::ofstream ofs(vm["save"].as<std::string>(), std::ios::binary);
+    boost::archive::binary_oarchive oa { ofs };
+    oa << g;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  std::cout.imbue(std::locale(""));
+
+  std::string loadFileName {};
+  unsigned short dim = 3;
+  ContractionOptions options {};
+
+  po::options_description loading { "loading options" };
+  // clang-format off
+  loading.add_options()
+    ("text,t", po::value<std::string>(&loadFileName), "load uncontracted graph from text file")
+    ("zi", "input text file is gzipped")
+    ("dimension,d", po::value<unsigned short>(&dim), "Dimension of loaded Graph");
+  // clang-format on
+
+  po::options_description output { "output options" };
+  // clang-format off
+  output.add_options()
+    ("output,o", po::value<std::string>(), "write contracted graph to text file")
+    ("save", po::value<std::string>(), "save contracted graph to binary file");
+  // clang-format on
+
+  po::options_description contraction { "contraction options" };
+  // clang-format off
+  contraction.add_options()
+    ("threads", po::value<size_t>(&options.threadCount), "number of threads, 0 uses all cores")
+    ("round-share", po::value<double>(&options.roundShare), "share of each independent set contracted per round")
+    ("settle-limit", po::value<size_t>(&options.witnessSettleLimit), "maximal settled nodes per witness search")
+    ("witness-rounds", po::value<size_t>(&options.maxWitnessRounds), "maximal witness searches per shortcut");
+  // clang-format on
+
+  po::options_description all;
+  all.add_options()("help,h", "prints help message");
+  all.add(loading).add(output).add(contraction);
+
+  po::variables_map vm {};
+  po::store(po::parse_command_line(argc, argv, all), vm);
+  po::notify(vm);
+
+  if (vm.count("help") > 0 || vm.count("text") == 0) {
+    std::cout << all << '\n';
+    return 0;
+  }
+  if (vm.count("output") == 0 && vm.count("save") == 0) {
+    std::cout << "No output file given" << '\n';
+    return 1;
+  }
+
+  switch (dim) {
+  case 1:
+    return run<1>(vm, loadFileName, options);
+  case 2:
+    return run<2>(vm, loadFileName, options);
+  case 3:
+    return run<3>(vm, loadFileName, options);
+  case 4:
+    return run<4>(vm, loadFileName, options);
+  default:
+    std::cout << "Code is not compiled for Dimension " << dim << '\n';
+    break;
+  }
+  return 0;
+}
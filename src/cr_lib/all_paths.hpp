@@ -20,42 +20,27 @@
 
 #include "dijkstra.hpp"
 #include "graph.hpp"
+#include "pareto_front.hpp"
+#include "pareto_search.hpp"
 
 #include <numeric>
 
-template <int Dim> bool dominates(const Cost<Dim>& c1, const Cost<Dim>& c2)
-{
-  for (size_t i = 0; i < Dim; ++i) {
-    if (c1.values[i] > c2.values[i])
-      return false;
-  }
-  return true;
-};
-
-template <int Dim> bool is_dominated_by(const Cost<Dim>& c, const std::vector<Route<Dim>>& routes)
-{
-  return std::any_of(
-      routes.begin(), routes.end(), [&](const auto& r) { return dominates(r.costs, c); });
-}
-
+// Enumerates every simple path from s to t, only feasible for tiny graphs.
+// With pareto_only the Pareto set comes from ParetoSearch instead.
 template <int Dim, bool pareto_only = false>
 std::vector<Route<Dim>> find_all_paths(Graph<Dim>& g, NodePos s, NodePos t)
 {
+  if constexpr (pareto_only) {
+    return ParetoSearch<Dim>(&g).run(s, t);
+  }
+
   std::vector<Route<Dim>> result;
   std::vector<EdgeId> stack;
   std::vector<EdgeId> cur_route;
   std::vector<size_t> removal_stack;
   Cost<Dim> cur_cost;
+  const auto& edges = g.getEdges();
 
-  if constexpr (pareto_only) {
-    auto d = g.createDijkstra();
-    Config<Dim> conf = std::vector<double>(Dim, 0.0);
-    conf.values[0] = 1.0;
-    auto r = d.findBestRoute(s, t, conf);
-    if (r) {
-      pareto_push(result, *r);
-    }
-  }
   std::cout << "\n";
   for (const auto e : g.getOutgoingEdgesOf(s)) {
     stack.push_back(e.id);
@@ -64,42 +49,33 @@ std::vector<Route<Dim>> find_all_paths(Graph<Dim>& g, NodePos s, NodePos t)
   while (!stack.empty()) {
     auto cur_edge = stack.back();
     stack.pop_back();
-    auto next_node = Edge<Dim>::destPos(cur_edge);
+    auto next_node = edges.destPos(cur_edge);
 
     while (!removal_stack.empty() && stack.size() < removal_stack.back()) {
-      cur_cost = cur_cost - Edge<Dim>::getCost(cur_route.back());
+      cur_cost = cur_cost - edges.getCost(cur_route.back());
       cur_route.pop_back();
       removal_stack.pop_back();
     }
-    if (Edge<Dim>::getEdgeA(cur_edge)) {
+    if (edges.getEdgeA(cur_edge)) {
       continue;
     }
 
     if (std::any_of(cur_route.begin(), cur_route.end(),
-            [&next_node](const EdgeId& e) { return Edge<Dim>::sourcePos(e) == next_node; })) {
+            [&](const EdgeId& e) { return edges.sourcePos(e) == next_node; })) {
       continue;
     }
-    if constexpr (pareto_only) {
-      if (is_dominated_by(cur_cost, result) && stack.size() % 150 == 0) {
-        continue;
-      }
-    }
 
     removal_stack.push_back(stack.size());
 
     cur_route.push_back(cur_edge);
-    cur_cost = cur_cost + Edge<Dim>::getCost(cur_edge);
+    cur_cost = cur_cost + edges.getCost(cur_edge);
     if (next_node == t) {
 
       std::deque<EdgeId> edges(cur_route.begin(), cur_route.end());
       Route<Dim> r;
       r.costs = cur_cost;
       r.edges = edges;
-      if constexpr (pareto_only) {
-        pareto_push(result, r);
-      } else {
-        result.push_back(r);
-      }
+      result.push_back(r);
       continue;
     }
 
@@ -112,28 +88,13 @@ std::vector<Route<Dim>> find_all_paths(Graph<Dim>& g, NodePos s, NodePos t)
   return result;
 }
 
-template <int Dim> bool pareto_push(std::vector<Route<Dim>>& routes, const Route<Dim>& route)
-{
-  if (is_dominated_by(route.costs, routes)) {
-    return false;
-  }
-
-  auto pos = std::partition(routes.begin(), routes.end(),
-      [&](const auto& r) { return !dominates(route.costs, r.costs); });
-  routes.erase(pos, routes.end());
-  routes.push_back(route);
-  return true;
-}
-
 template <int Dim> std::vector<Route<Dim>> pareto_only(const std::vector<Route<Dim>>& routes)
 {
-  std::vector<Route<Dim>> results;
-
+  ParetoFront<Dim, Route<Dim>> front;
   for (const auto& route : routes) {
-    pareto_push(results, route);
+    front.insert(route.costs, route);
   }
-
-  return results;
+  return front.getValues();
 }
 
 #endif /* ALL_PATHS_H */
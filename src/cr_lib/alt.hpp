@@ -0,0 +1,111 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef ALT_H
+#define ALT_H
+
+#include "dijkstra.hpp"
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+// Distances from and to a few landmarks for every metric on their own. By the
+// triangle inequality they bound the cost between any two nodes from below
+// per metric, the bounds of all metrics combine linearly for any
+// configuration. Only original edges are used, shortcuts do not change the
+// distances.
+//
+// Landmarks are the nodes farthest from the center of the graph in equally
+// sized sectors around it. Distances are stored as floats, bounds subtract
+// the possible rounding error to stay admissible.
+template <int Dim> class Landmarks {
+  public:
+  using GraphD = Graph<Dim>;
+  using ConfigD = Config<Dim>;
+
+  Landmarks(const GraphD& g, size_t count = 8, size_t threadCount = 0);
+
+  double lowerBound(NodePos from, NodePos to, const ConfigD& config) const;
+  const std::vector<NodePos>& getNodes() const { return landmarks; }
+
+  private:
+  enum Direction { From = 0, To = 1 };
+
+  void computeDistances(const GraphD& g, size_t landmark, size_t metric, Direction dir);
+  size_t index(NodePos node, size_t landmark, size_t metric, Direction dir) const
+  {
+    return ((node * landmarks.size() + landmark) * Dim + metric) * 2 + dir;
+  }
+
+  std::vector<NodePos> landmarks;
+  std::vector<float> distances;
+};
+
+// A* and bidirectional A* on the original edges with the landmark bounds as
+// potentials. Used as the reference for the CH query.
+template <int Dim> class AltDijkstra {
+  public:
+  using GraphD = Graph<Dim>;
+  using ConfigD = Config<Dim>;
+  using CostD = Cost<Dim>;
+  using EdgeD = Edge<Dim>;
+  using RouteD = Route<Dim>;
+  using LandmarksD = Landmarks<Dim>;
+
+  AltDijkstra(const GraphD* g, const LandmarksD* landmarks);
+
+  std::optional<RouteD> findBestRoute(NodePos from, NodePos to, const ConfigD& config);
+  std::optional<RouteD> findBestRouteForward(NodePos from, NodePos to, const ConfigD& config);
+
+  size_t pqPops = 0;
+
+  private:
+  enum Direction { Forward = 0, Backward = 1 };
+  // Key, distance and node. Entries whose distance was improved later are
+  // skipped when popped.
+  using QueueElem = std::tuple<double, double, NodePos>;
+  using Queue = std::priority_queue<QueueElem, std::vector<QueueElem>, std::greater<QueueElem>>;
+
+  void clearState();
+  bool reached(Direction dir, NodePos node) const;
+  void reach(Direction dir, NodePos node);
+  double potential(NodePos node);
+  template <class Relax> void relaxEdges(Direction dir, NodePos node, double dist, Relax relax);
+  RouteD buildRoute(NodePos meeting) const;
+
+  const GraphD* graph;
+  const LandmarksD* landmarks;
+  NodePos from, to;
+  ConfigD config;
+  bool bidirectional = false;
+
+  uint32_t epoch = 0;
+  std::array<std::vector<uint32_t>, 2> reachedIn;
+  std::array<std::vector<double>, 2> cost;
+  std::array<std::vector<EdgeId>, 2> previousEdge;
+  std::vector<uint32_t> potentialIn;
+  std::vector<double> potentials;
+  std::array<Queue, 2> heap;
+};
+
+#include "alt.inc"
+#endif /* ALT_H */
@@ -0,0 +1,130 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMPUTE_EXECUTOR_H
+#define COMPUTE_EXECUTOR_H
+
+#include "multiqueue.hpp"
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Caps how many jobs of one kind may be queued or running at the same time.
+class AdmissionLimit {
+  public:
+  AdmissionLimit(size_t limit)
+      : limit(limit)
+  {
+  }
+  AdmissionLimit(const AdmissionLimit& other) = delete;
+  AdmissionLimit& operator=(const AdmissionLimit& other) = delete;
+
+  bool try_acquire()
+  {
+    auto current = used.load();
+    do {
+      if (current >= limit) {
+        return false;
+      }
+    } while (!used.compare_exchange_weak(current, current + 1));
+    return true;
+  }
+  void release() { --used; }
+  size_t in_use() const { return used.load(); }
+
+  private:
+  std::atomic<size_t> used { 0 };
+  size_t limit;
+};
+
+// Fixed set of worker threads for expensive requests with a bounded queue in
+// front of them. Submitting never blocks, so callers can reject work instead
+// of piling it up. Tasks get the index of the worker running them to reuse
+// per worker state.
+class ComputeExecutor {
+  public:
+  using Task = std::function<void(size_t worker)>;
+
+  ComputeExecutor(size_t threadCount, size_t queueDepth)
+      : queue(queueDepth)
+  {
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+      workers.emplace_back([this, i]() { work(i); });
+    }
+  }
+  ComputeExecutor(const ComputeExecutor& other) = delete;
+  ComputeExecutor& operator=(const ComputeExecutor& other) = delete;
+  virtual ~ComputeExecutor() noexcept
+  {
+    queue.close();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  bool try_submit(Task task) { return queue.try_send(task); }
+
+  // The limit is held until the task finished or the submission failed.
+  bool try_submit(AdmissionLimit& limit, Task task)
+  {
+    if (!limit.try_acquire()) {
+      return false;
+    }
+    auto accepted = queue.try_send([&limit, task = std::move(task)](size_t worker) {
+      struct Release {
+        AdmissionLimit& limit;
+        ~Release() { limit.release(); }
+      } release { limit };
+      task(worker);
+    });
+    if (!accepted) {
+      limit.release();
+    }
+    return accepted;
+  }
+
+  size_t worker_count() const { return workers.size(); }
+  size_t queue_depth() { return queue.size(); }
+
+  private:
+  void work(size_t worker)
+  {
+    while (!queue.closed()) {
+      Task task;
+      try {
+        task = queue.receive();
+      } catch (std::exception&) {
+        continue;
+      }
+      try {
+        task(worker);
+      } catch (std::exception& e) {
+        std::cerr << "compute task failed: " << e.what() << '\n';
+      }
+    }
+  }
+
+  MultiQueue<Task> queue;
+  std::vector<std::thread> workers;
+};
+
+#endif /* COMPUTE_EXECUTOR_H */
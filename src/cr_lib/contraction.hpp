@@ -0,0 +1,458 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef CONTRACTION_H
+#define CONTRACTION_H
+
+#include "contractionLP.hpp"
+#include "dijkstra.hpp"
+#include "graph.hpp"
+#include "ilp_independent_set.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <iomanip>
+#include <limits>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+struct ContractionOptions {
+  // 0 uses all hardware threads.
+  size_t threadCount = 0;
+  // Share of each independent set which is contracted in one round, cheapest
+  // nodes first.
+  double roundShare = 0.5;
+  // Witness searches giving up earlier keep the shortcut.
+  size_t witnessSettleLimit = 2000;
+  size_t maxWitnessRounds = 32;
+};
+
+// Edges refer to nodes by position. Shortcuts refer to the edges they replace
+// by their index, just like in the text format.
+template <int Dim> struct ContractionEdge {
+  NodePos source;
+  NodePos target;
+  Cost<Dim> cost;
+  long edgeA = -1;
+  long edgeB = -1;
+};
+
+// Builds a multicriteria contraction hierarchy. Every round contracts an
+// independent set of nodes in parallel. A shortcut is skipped if, for every
+// configuration, some path avoiding the contracted nodes is at most as
+// expensive. The configurations to check are found by a ContractionLp over
+// the witnesses found so far.
+template <int Dim> class Contraction {
+  public:
+  using CostD = Cost<Dim>;
+  using ConfigD = Config<Dim>;
+  using ContractionEdgeD = ContractionEdge<Dim>;
+
+  Contraction(std::vector<Node> nodes, std::vector<size_t> osmIds,
+      std::vector<ContractionEdgeD> edges)
+      : nodes(std::move(nodes))
+      , osmIds(std::move(osmIds))
+      , edges(std::move(edges))
+      , outEdges(this->nodes.size())
+      , inEdges(this->nodes.size())
+      , contracted(this->nodes.size(), false)
+  {
+    for (uint32_t i = 0; i < this->edges.size(); ++i) {
+      const auto& edge = this->edges[i];
+      if (edge.source == edge.target) {
+        continue;
+      }
+      outEdges[edge.source].push_back(i);
+      inEdges[edge.target].push_back(i);
+    }
+  }
+
+  // Reads an uncontracted graph in the text format of Graph::createFromStream.
+  static Contraction createFromStream(std::istream& file)
+  {
+    std::string line {};
+    std::getline(file, line);
+    while (line.front() == '#') {
+      std::getline(file, line);
+    }
+
+    auto readCount = [&file, &line]() {
+      std::getline(file, line);
+      return std::stoul(line);
+    };
+    if (readCount() != Dim) {
+      throw std::runtime_error("Graph has wrong dimension");
+    }
+    const size_t nodeCount = readCount();
+    const size_t edgeCount = readCount();
+
+    std::vector<Node> nodes;
+    std::vector<size_t> osmIds;
+    nodes.reserve(nodeCount);
+    osmIds.reserve(nodeCount);
+    for (size_t i = 0; i < nodeCount; ++i) {
+      std::getline(file, line);
+      std::istringstream text { line };
+      nodes.push_back(Node::createFromText(text));
+      size_t id, osmId;
+      text.clear();
+      text.seekg(0);
+      text >> id >> osmId;
+      osmIds.push_back(osmId);
+    }
+
+    std::vector<NodePos> positions;
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+      positions.resize(std::max<size_t>(positions.size(), nodes[i].id() + 1), NodePos { 0 });
+      positions[nodes[i].id()] = NodePos { i };
+    }
+
+    std::vector<ContractionEdgeD> edges;
+    edges.reserve(edgeCount);
+    for (size_t i = 0; i < edgeCount; ++i) {
+      auto edge = Edge<Dim>::createFromText(file);
+      if (edge.getEdgeA()) {
+        throw std::runtime_error("Graph is already contracted");
+      }
+      edges.push_back(ContractionEdgeD { positions.at(edge.getSourceId()),
+          positions.at(edge.getDestId()), edge.getCost() });
+    }
+
+    return Contraction { std::move(nodes), std::move(osmIds), std::move(edges) };
+  }
+
+  // Returns the number of nodes contracted, 0 once all nodes are contracted.
+  size_t contractRound(const ContractionOptions& options)
+  {
+    std::vector<uint32_t> remaining;
+    std::vector<size_t> localIndex(nodes.size());
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+      if (!contracted[i]) {
+        localIndex[i] = remaining.size();
+        remaining.push_back(i);
+      }
+    }
+    if (remaining.empty()) {
+      return 0;
+    }
+
+    std::vector<std::pair<size_t, size_t>> conflicts;
+    for (auto node : remaining) {
+      for (auto edge : outEdges[node]) {
+        conflicts.emplace_back(localIndex[node], localIndex[edges[edge].target]);
+      }
+    }
+    duplicate_edges(conflicts);
+    std::vector<uint32_t> selected;
+    for (auto i : greedy_independent_set(remaining.size(), conflicts)) {
+      selected.push_back(remaining[i]);
+    }
+
+    // Nodes with few in and out edges create few shortcuts, they go first.
+    auto degree = [this](uint32_t node) { return outEdges[node].size() * inEdges[node].size(); };
+    std::stable_sort(selected.begin(), selected.end(),
+        [&degree](uint32_t a, uint32_t b) { return degree(a) < degree(b); });
+    const auto share = static_cast<size_t>(std::ceil(selected.size() * options.roundShare));
+    selected.resize(std::clamp<size_t>(share, 1, selected.size()));
+
+    // Witnesses must avoid the whole set, as all of it is removed at once.
+    for (auto node : selected) {
+      contracted[node] = true;
+      nodes[node].assignLevel(round);
+    }
+
+    // Shortcuts are kept per node so the edge ids do not depend on scheduling.
+    std::vector<std::vector<ContractionEdgeD>> shortcuts(selected.size());
+    std::atomic<size_t> next { 0 };
+    auto work = [this, &selected, &shortcuts, &next, &options]() {
+      WitnessSearch search { *this, options };
+      ContractionLp<Dim> lp;
+      for (size_t i = next++; i < selected.size(); i = next++) {
+        shortcuts[i] = contractNode(NodePos { selected[i] }, search, lp, options);
+      }
+    };
+
+    size_t threadCount = options.threadCount;
+    if (threadCount == 0) {
+      threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<std::future<void>> futures;
+    for (size_t i = 1; i < std::min(threadCount, selected.size()); ++i) {
+      futures.push_back(std::async(std::launch::async, work));
+    }
+    work();
+    for (auto& future : futures) {
+      future.get();
+    }
+
+    removeContracted(selected);
+    for (auto& nodeShortcuts : shortcuts) {
+      for (auto& shortcut : nodeShortcuts) {
+        const auto id = static_cast<uint32_t>(edges.size());
+        outEdges[shortcut.source].push_back(id);
+        inEdges[shortcut.target].push_back(id);
+        edges.push_back(std::move(shortcut));
+        ++shortcutCount;
+      }
+    }
+    ++round;
+    return selected.size();
+  }
+
+  void contract(const ContractionOptions& options)
+  {
+    while (contractRound(options) > 0) {
+    }
+  }
+
+  // Writes the text format read by Graph::createFromStream.
+  void writeText(std::ostream& out) const
+  {
+    out << "# Build by: cr_contract" << '\n';
+    out << '\n';
+    out << Dim << '\n';
+    out << nodes.size() << '\n';
+    out << edges.size() << '\n';
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      const auto& node = nodes[i];
+      out << node.id() << ' ' << osmIds[i] << ' ' << node.lat() << ' ' << node.lng() << ' '
+          << node.height() << ' ' << node.getLevel() << '\n';
+    }
+    for (const auto& edge : edges) {
+      out << nodes[edge.source].id() << ' ' << nodes[edge.target].id();
+      for (auto value : edge.cost.values) {
+        out << ' ' << value;
+      }
+      out << ' ' << edge.edgeA << ' ' << edge.edgeB << '\n';
+    }
+  }
+
+  Graph<Dim> createGraph() const
+  {
+    std::vector<Edge<Dim>> graphEdges;
+    graphEdges.reserve(edges.size());
+    for (const auto& edge : edges) {
+      ReplacedEdge edgeA = {};
+      ReplacedEdge edgeB = {};
+      if (edge.edgeA >= 0) {
+        edgeA = EdgeId { static_cast<uint32_t>(edge.edgeA) };
+        edgeB = EdgeId { static_cast<uint32_t>(edge.edgeB) };
+      }
+      Edge<Dim> e { nodes[edge.source].id(), nodes[edge.target].id(), edgeA, edgeB };
+      e.setCost(edge.cost);
+      graphEdges.push_back(std::move(e));
+    }
+    return Graph<Dim> { std::vector<Node>(nodes), std::move(graphEdges) };
+  }
+
+  const std::vector<Node>& getNodes() const { return nodes; }
+  const std::vector<ContractionEdgeD>& getEdges() const { return edges; }
+  uint32_t getRounds() const { return round; }
+  size_t getShortcutCount() const { return shortcutCount; }
+
+  private:
+  // Local Dijkstra on the not yet contracted nodes, one per thread.
+  class WitnessSearch {
+    public:
+    WitnessSearch(const Contraction& contraction, const ContractionOptions& options)
+        : contraction(contraction)
+        , settleLimit(options.witnessSettleLimit)
+        , costs(contraction.nodes.size(), std::numeric_limits<double>::max())
+        , pathCosts(contraction.nodes.size())
+    {
+    }
+
+    // Returns the cost of a path from source to target which is at most limit
+    // expensive under config.
+    std::optional<CostD> find(NodePos source, NodePos target, const ConfigD& config, double limit)
+    {
+      for (auto node : touched) {
+        costs[node] = std::numeric_limits<double>::max();
+      }
+      touched.clear();
+      heap = Queue {};
+
+      const double bound = limit + EPSILON;
+      costs[source] = 0;
+      pathCosts[source] = CostD {};
+      touched.push_back(source);
+      heap.push({ 0, source });
+      size_t settled = 0;
+      while (!heap.empty()) {
+        auto [cost, node] = heap.top();
+        heap.pop();
+        if (cost > costs[node]) {
+          continue;
+        }
+        if (node == target) {
+          return pathCosts[node];
+        }
+        if (cost > bound || ++settled > settleLimit) {
+          return {};
+        }
+        for (auto id : contraction.outEdges[node]) {
+          const auto& edge = contraction.edges[id];
+          if (contraction.contracted[edge.target]) {
+            continue;
+          }
+          const double nextCost = cost + edge.cost * config;
+          if (nextCost < costs[edge.target] && nextCost <= bound) {
+            if (costs[edge.target] == std::numeric_limits<double>::max()) {
+              touched.push_back(edge.target);
+            }
+            costs[edge.target] = nextCost;
+            pathCosts[edge.target] = pathCosts[node] + edge.cost;
+            heap.push({ nextCost, edge.target });
+          }
+        }
+      }
+      return {};
+    }
+
+    private:
+    using QueueElem = std::pair<double, uint32_t>;
+    using Queue
+        = std::priority_queue<QueueElem, std::vector<QueueElem>, std::greater<QueueElem>>;
+
+    const Contraction& contraction;
+    size_t settleLimit;
+    std::vector<double> costs;
+    std::vector<CostD> pathCosts;
+    std::vector<uint32_t> touched;
+    Queue heap;
+  };
+
+  static constexpr double EPSILON = 1e-6;
+
+  static bool dominates(const CostD& a, const CostD& b)
+  {
+    for (size_t i = 0; i < Dim; ++i) {
+      if (a.values[i] > b.values[i] + EPSILON) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool isShortcutNeeded(const ContractionEdgeD& shortcut, WitnessSearch& search,
+      ContractionLp<Dim>& lp, const ContractionOptions& options) const
+  {
+    lp.reset(shortcut.cost);
+    ConfigD config { std::vector<double>(Dim, 1.0 / Dim) };
+    for (size_t i = 0; i < options.maxWitnessRounds; ++i) {
+      if (i > 0) {
+        // Without a configuration the same witness would be found again.
+        const auto result = lp.solve();
+        if (result == ContractionLp<Dim>::Result::Dominated) {
+          return false;
+        }
+        if (result == ContractionLp<Dim>::Result::Failed) {
+          return true;
+        }
+        config = ConfigD { lp.variableValues() };
+      }
+      auto witness = search.find(shortcut.source, shortcut.target, config, shortcut.cost * config);
+      if (!witness) {
+        return true;
+      }
+      if (dominates(*witness, shortcut.cost)) {
+        return false;
+      }
+      lp.addConstraint(*witness);
+    }
+    return true;
+  }
+
+  std::vector<ContractionEdgeD> contractNode(NodePos node, WitnessSearch& search,
+      ContractionLp<Dim>& lp, const ContractionOptions& options) const
+  {
+    std::vector<ContractionEdgeD> shortcuts;
+    std::vector<ContractionEdgeD> candidates;
+    for (auto in : inEdges[node]) {
+      for (auto out : outEdges[node]) {
+        const auto& first = edges[in];
+        const auto& second = edges[out];
+        if (first.source == second.target) {
+          continue;
+        }
+        candidates.push_back(ContractionEdgeD { first.source, second.target,
+            first.cost + second.cost, static_cast<long>(in), static_cast<long>(out) });
+      }
+    }
+
+    // Parallel edges around the node lead to candidates dominating each other.
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      const auto& candidate = candidates[i];
+      bool dominated = false;
+      for (size_t j = 0; j < candidates.size() && !dominated; ++j) {
+        const auto& other = candidates[j];
+        dominated = i != j && other.source == candidate.source
+            && other.target == candidate.target && dominates(other.cost, candidate.cost)
+            && (candidate.cost != other.cost || j < i);
+      }
+      if (!dominated && isShortcutNeeded(candidate, search, lp, options)) {
+        shortcuts.push_back(candidate);
+      }
+    }
+    return shortcuts;
+  }
+
+  void removeContracted(const std::vector<uint32_t>& selected)
+  {
+    std::vector<uint32_t> neighbours;
+    for (auto node : selected) {
+      for (auto edge : inEdges[node]) {
+        neighbours.push_back(edges[edge].source);
+      }
+      for (auto edge : outEdges[node]) {
+        neighbours.push_back(edges[edge].target);
+      }
+      inEdges[node] = {};
+      outEdges[node] = {};
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+    for (auto node : neighbours) {
+      auto& out = outEdges[node];
+      out.erase(std::remove_if(out.begin(), out.end(),
+                    [this](uint32_t edge) { return contracted[edges[edge].target]; }),
+          out.end());
+      auto& in = inEdges[node];
+      in.erase(std::remove_if(in.begin(), in.end(),
+                   [this](uint32_t edge) { return contracted[edges[edge].source]; }),
+          in.end());
+    }
+  }
+
+  std::vector<Node> nodes;
+  std::vector<size_t> osmIds;
+  std::vector<ContractionEdgeD> edges;
+  std::vector<std::vector<uint32_t>> outEdges;
+  std::vector<std::vector<uint32_t>> inEdges;
+  std::vector<bool> contracted;
+  uint32_t round = 0;
+  size_t shortcutCount = 0;
+};
+
+#endif /* CONTRACTION_H */
@@ -18,64 +18,284 @@
 #ifndef CONTRACTIONLP_H
 #define CONTRACTIONLP_H
 
-#include "child.hpp"
 #include "graph.hpp"
-#include "io.hpp"
 
-namespace bp = boost::process;
-class ContractionLp {
+#include "glpk.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Finds the configuration where a shortcut is cheaper than all witnesses by
+// the largest margin:
+//
+//   max delta  s.t.  (witness - shortcut) * alpha >= delta  for all witnesses
+//                    sum alpha = 1, alpha >= 0
+//
+// Objects are meant to be reused by one thread for many shortcuts. Witness
+// rows are buffered and added in one go when GLPK is needed. Small problems
+// are solved by enumerating the vertices of the polytope instead.
+template <int Dim> class ContractionLp {
   public:
+  using CostD = Cost<Dim>;
+
   ContractionLp()
-      : lp("./build/cr_lp", std::to_string(Cost::dim), bp::std_out > lpOutput,
-            bp::std_in < lpInput){};
-  ContractionLp(const ContractionLp& other) = delete;
-  ContractionLp(ContractionLp&& other)
   {
-    lpOutput = std::move(other.lpOutput);
-    lpInput = std::move(other.lpInput);
-    lp = std::move(other.lp);
-    lpResult = std::move(other.lpResult);
+    glp_term_out(GLP_OFF);
+    glp_init_smcp(&params);
+    params.msg_lev = GLP_MSG_OFF;
+    // Added rows keep the last basis dual feasible.
+    params.meth = GLP_DUALP;
+
+    lp = glp_create_prob();
+    glp_set_obj_dir(lp, GLP_MAX);
+    glp_add_cols(lp, Dim + 1);
+    for (int i = 1; i <= Dim; ++i) {
+      glp_set_col_bnds(lp, i, GLP_DB, 0, 1);
+    }
+    glp_set_col_bnds(lp, Dim + 1, GLP_FR, 0, 0);
+    glp_set_obj_coef(lp, Dim + 1, 1);
+
+    std::array<int, Dim + 1> indices;
+    std::array<double, Dim + 1> values;
+    for (int i = 1; i <= Dim; ++i) {
+      indices[i] = i;
+      values[i] = 1;
+    }
+    glp_add_rows(lp, 1);
+    glp_set_mat_row(lp, 1, Dim, indices.data(), values.data());
+    glp_set_row_bnds(lp, 1, GLP_FX, 1, 1);
   }
-  virtual ~ContractionLp() noexcept = default;
+  ContractionLp(const ContractionLp& other) = delete;
+  ContractionLp(ContractionLp&& other) = delete;
+  virtual ~ContractionLp() noexcept { glp_delete_prob(lp); }
   ContractionLp& operator=(const ContractionLp& other) = delete;
-  ContractionLp& operator=(ContractionLp&& other) = default;
+  ContractionLp& operator=(ContractionLp&& other) = delete;
+
+  // Starts the check of another shortcut. The basis of the last solve is
+  // kept as starting point.
+  void reset(const CostD& shortcut)
+  {
+    this->shortcut = shortcut;
+    rows.clear();
+    const int rowCount = glp_get_num_rows(lp);
+    if (rowCount > 1) {
+      std::vector<int> witnessRows { 0 };
+      for (int i = 2; i <= rowCount; ++i) {
+        witnessRows.push_back(i);
+      }
+      glp_del_rows(lp, rowCount - 1, witnessRows.data());
+    }
+    addedRows = 0;
+  }
+
+  void addConstraint(const CostD& witness) { rows.push_back(witness - shortcut); }
+
+  // Dominated if the witnesses are at most as expensive as the shortcut for
+  // every configuration. Failed if no configuration could be computed.
+  enum class Result { Cheaper, Dominated, Failed };
+
+  Result solve()
+  {
+    if (rows.empty()) {
+      alpha.fill(1.0 / Dim);
+      return Result::Cheaper;
+    }
+    if constexpr (Dim <= 4) {
+      if (vertexCandidates() <= FAST_PATH_CANDIDATES) {
+        return solveByVertices();
+      }
+    }
+    return solveWithGlpk();
+  }
+
+  std::vector<double> variableValues() const
+  {
+    return std::vector<double>(alpha.begin(), alpha.end());
+  }
 
-  void addConstraint(const double (&coeff)[Cost::dim])
+  private:
+  static constexpr double EPSILON = 1e-6;
+  static constexpr size_t FAST_PATH_CANDIDATES = 512;
+
+  // Every vertex has Dim active constraints out of the Dim bounds and the rows.
+  size_t vertexCandidates() const
   {
-    for (size_t i = 0; i < Cost::dim; ++i) {
-      lpInput << coeff[i] << ' ';
+    size_t count = 1;
+    for (size_t i = 1; i <= Dim; ++i) {
+      count = count * (rows.size() + i) / i;
+      if (count > FAST_PATH_CANDIDATES) {
+        break;
+      }
     }
-    lpInput << '\n';
+    return count;
   }
-  bool solve()
+
+  // alpha_Dim is replaced by 1 - sum of the others, which leaves Dim
+  // unknowns: alpha_1 ... alpha_Dim-1 and delta. Constraints are stored as
+  // coefficients * x >= rhs, the rhs in the last entry.
+  Result solveByVertices()
   {
-    lpInput << '\n';
-    lpInput.flush();
-    lpOutput >> lpResult;
-    if (lpResult == "Infeasible") {
-      return false;
+    using Constraint = std::array<double, Dim + 1>;
+    std::vector<Constraint> constraints;
+    constraints.reserve(Dim + rows.size());
+    for (size_t i = 0; i + 1 < Dim; ++i) {
+      Constraint bound {};
+      bound[i] = 1;
+      constraints.push_back(bound);
+    }
+    Constraint lastBound {};
+    for (size_t i = 0; i + 1 < Dim; ++i) {
+      lastBound[i] = -1;
+    }
+    lastBound[Dim] = -1;
+    constraints.push_back(lastBound);
+    for (const auto& row : rows) {
+      Constraint c {};
+      for (size_t i = 0; i + 1 < Dim; ++i) {
+        c[i] = row.values[i] - row.values[Dim - 1];
+      }
+      c[Dim - 1] = -1;
+      c[Dim] = -row.values[Dim - 1];
+      constraints.push_back(c);
+    }
+
+    bool found = false;
+    double bestDelta = std::numeric_limits<double>::lowest();
+    std::array<double, Dim> best {};
+    std::array<size_t, Dim> active;
+    for (size_t i = 0; i < Dim; ++i) {
+      active[i] = i;
+    }
+    const size_t count = constraints.size();
+    while (true) {
+      std::array<double, Dim> x;
+      if (solveActive(constraints, active, x) && x[Dim - 1] > bestDelta) {
+        bool feasible = true;
+        for (const auto& c : constraints) {
+          double lhs = 0;
+          for (size_t i = 0; i < Dim; ++i) {
+            lhs += c[i] * x[i];
+          }
+          if (lhs < c[Dim] - EPSILON) {
+            feasible = false;
+            break;
+          }
+        }
+        if (feasible) {
+          found = true;
+          bestDelta = x[Dim - 1];
+          best = x;
+        }
+      }
+
+      // Next subset in lexicographic order.
+      size_t i = Dim;
+      while (i > 0 && active[i - 1] == count - Dim + i - 1) {
+        --i;
+      }
+      if (i == 0) {
+        break;
+      }
+      ++active[i - 1];
+      for (size_t j = i; j < Dim; ++j) {
+        active[j] = active[j - 1] + 1;
+      }
+    }
+
+    if (!found) {
+      alpha.fill(1.0 / Dim);
+      return Result::Failed;
+    }
+    double last = 1;
+    for (size_t i = 0; i + 1 < Dim; ++i) {
+      alpha[i] = std::max(0.0, best[i]);
+      last -= alpha[i];
+    }
+    alpha[Dim - 1] = std::max(0.0, last);
+    return bestDelta > EPSILON ? Result::Cheaper : Result::Dominated;
+  }
+
+  // Gaussian elimination with partial pivoting on the active constraints.
+  template <class Constraints>
+  static bool solveActive(const Constraints& constraints, const std::array<size_t, Dim>& active,
+      std::array<double, Dim>& x)
+  {
+    std::array<std::array<double, Dim + 1>, Dim> m;
+    for (size_t r = 0; r < Dim; ++r) {
+      m[r] = constraints[active[r]];
+    }
+    for (size_t c = 0; c < Dim; ++c) {
+      size_t pivot = c;
+      for (size_t r = c + 1; r < Dim; ++r) {
+        if (std::abs(m[r][c]) > std::abs(m[pivot][c])) {
+          pivot = r;
+        }
+      }
+      if (std::abs(m[pivot][c]) < 1e-12) {
+        return false;
+      }
+      std::swap(m[pivot], m[c]);
+      for (size_t r = 0; r < Dim; ++r) {
+        if (r != c) {
+          const double factor = m[r][c] / m[c][c];
+          for (size_t k = c; k <= Dim; ++k) {
+            m[r][k] -= factor * m[c][k];
+          }
+        }
+      }
+    }
+    for (size_t c = 0; c < Dim; ++c) {
+      x[c] = m[c][Dim] / m[c][c];
     }
     return true;
   }
-  std::vector<double> variableValues()
+
+  Result solveWithGlpk()
   {
+    if (addedRows < rows.size()) {
+      int first = glp_add_rows(lp, rows.size() - addedRows);
+      std::array<int, Dim + 2> indices;
+      std::array<double, Dim + 2> values;
+      for (int i = 1; i <= Dim + 1; ++i) {
+        indices[i] = i;
+      }
+      values[Dim + 1] = -1;
+      for (size_t r = addedRows; r < rows.size(); ++r, ++first) {
+        for (int i = 1; i <= Dim; ++i) {
+          values[i] = rows[r].values[i - 1];
+        }
+        glp_set_mat_row(lp, first, Dim + 1, indices.data(), values.data());
+        glp_set_row_bnds(lp, first, GLP_LO, 0, 0);
+      }
+      addedRows = rows.size();
+    }
 
-    std::vector<double> result;
-    result.push_back(std::stod(lpResult));
-    double coeff = 0;
-    for (size_t i = 1; i < Cost::dim; ++i) {
-      lpOutput >> coeff;
-      result.push_back(coeff);
+    // Deleted rows can leave an invalid basis behind.
+    if (glp_simplex(lp, &params) != 0) {
+      glp_std_basis(lp);
+      if (glp_simplex(lp, &params) != 0) {
+        alpha.fill(1.0 / Dim);
+        return Result::Failed;
+      }
+    }
+    if (glp_get_status(lp) != GLP_OPT) {
+      alpha.fill(1.0 / Dim);
+      return Result::Failed;
     }
-    return result;
+    for (int i = 1; i <= Dim; ++i) {
+      alpha[i - 1] = glp_get_col_prim(lp, i);
+    }
+    return glp_get_obj_val(lp) > EPSILON ? Result::Cheaper : Result::Dominated;
   }
 
-  protected:
-  private:
-  bp::ipstream lpOutput;
-  bp::opstream lpInput;
-  bp::child lp;
-  std::string lpResult;
+  glp_prob* lp;
+  glp_smcp params;
+  CostD shortcut;
+  std::vector<CostD> rows;
+  size_t addedRows = 0;
+  std::array<double, Dim> alpha;
 };
 
 #endif /* CONTRACTIONLP_H */
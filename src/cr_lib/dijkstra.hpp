@@ -19,6 +19,7 @@
 #define DIJKSTRA_H
 
 #include "graph.hpp"
+#include "segment_index.hpp"
 #include <cmath>
 #include <iostream>
 #include <queue>
@@ -86,6 +87,8 @@ template <int Dim> struct Config {
 };
 
 template <int Dim> Config<Dim> generateRandomConfig();
+// Draws from gen instead of a random device, for reproducible configurations.
+template <int Dim, class Generator> Config<Dim> generateRandomConfig(Generator& gen);
 
 template <int Dim> std::ostream& operator<<(std::ostream& stream, const Config<Dim>& c);
 
@@ -94,6 +97,15 @@ template <int Dim> struct Route {
   std::deque<EdgeId> edges;
 };
 
+// Start or end of a query that is not a node of the graph. The query
+// continues at node with the partial cost of reaching it. If edge is set, it
+// is the edge the virtual point lies on and becomes part of the route.
+template <int Dim> struct RouteEndpoint {
+  NodePos node;
+  Cost<Dim> cost;
+  std::optional<EdgeId> edge;
+};
+
 template <int Dim> class Dijkstra {
   public:
   using GraphD = Graph<Dim>;
@@ -109,10 +121,22 @@ template <int Dim> class Dijkstra {
   Dijkstra& operator=(const Dijkstra& other) = default;
   Dijkstra& operator=(Dijkstra&& other) = default;
 
+  using EndpointD = RouteEndpoint<Dim>;
+
   std::optional<RouteD> findBestRoute(NodePos from, NodePos to, ConfigD config);
+  std::optional<RouteD> findBestRoute(
+      const std::vector<EndpointD>& from, const std::vector<EndpointD>& to, ConfigD config);
+  // Routes between two points on road segments. The first and last edge of the
+  // route are the snapped edges, route.costs only contain their covered parts.
+  std::optional<RouteD> findBestRoute(
+      const SnappedPoint& from, const SnappedPoint& to, ConfigD config);
   void calcScalingFactor(NodePos from, NodePos to, ScalingFactor& f);
 
   size_t pqPops = 0;
+  size_t settledNodes = 0;
+  size_t relaxedEdges = 0;
+  // Time spent building and unpacking the last route in µs.
+  size_t unpackTime = 0;
 
   private:
   enum class Direction { S, T };
@@ -125,8 +149,13 @@ template <int Dim> class Dijkstra {
   void clearState();
 
   using NodeToEdgeMap = std::unordered_map<NodePos, EdgeId>;
-  RouteD buildRoute(NodePos node, NodeToEdgeMap& previousEdgeS, NodeToEdgeMap& previousEdgeT,
-      NodePos from, NodePos to);
+  using NodeToEndpointMap = std::unordered_map<NodePos, EndpointD>;
+  RouteD buildRoute(NodePos node, const NodeToEdgeMap& previousEdgeS,
+      const NodeToEdgeMap& previousEdgeT, const NodeToEndpointMap& from,
+      const NodeToEndpointMap& to);
+  // Both directions of the original edges a point was snapped to, with the
+  // position of the point on each of them.
+  std::vector<std::pair<EdgeId, double>> placements(const SnappedPoint& point) const;
 
   void relaxEdges(const NodePos& node, double cost, Direction dir, Queue& heap,
       NodeToEdgeMap& previousEdge, std::vector<double>& costs);
@@ -0,0 +1,132 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef DIJKSTRA_RANK_H
+#define DIJKSTRA_RANK_H
+
+#include "dijkstra.hpp"
+
+#include <iomanip>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// A query whose target is the rank-th node settled by a plain Dijkstra from
+// its source under config. The source itself has rank 0.
+template <int Dim> struct RankQuery {
+  size_t rank;
+  NodePos from;
+  NodePos to;
+  Config<Dim> config;
+};
+
+// Picks random sources and configurations from gen and runs one Dijkstra on
+// the original edges per source. The nodes settled at ranks 1, 2, 4, ...
+// become the targets, so queries of every difficulty are included.
+template <int Dim, class Generator>
+std::vector<RankQuery<Dim>> dijkstraRankQueries(const Graph<Dim>& g, size_t sources, Generator& gen)
+{
+  using QueueElem = std::pair<double, NodePos>;
+  std::vector<RankQuery<Dim>> queries;
+  if (g.getNodeCount() == 0) {
+    return queries;
+  }
+  std::uniform_int_distribution<uint32_t> node(0, g.getNodeCount() - 1);
+  std::vector<double> cost;
+  for (size_t s = 0; s < sources; ++s) {
+    const NodePos from { node(gen) };
+    const auto config = generateRandomConfig<Dim>(gen);
+
+    cost.assign(g.getNodeCount(), std::numeric_limits<double>::max());
+    std::priority_queue<QueueElem, std::vector<QueueElem>, std::greater<QueueElem>> heap;
+    cost[from] = 0;
+    heap.emplace(0, from);
+    size_t settled = 0;
+    size_t nextRank = 1;
+    while (!heap.empty()) {
+      auto [c, current] = heap.top();
+      heap.pop();
+      if (c > cost[current]) {
+        continue;
+      }
+      if (settled++ == nextRank) {
+        queries.push_back(RankQuery<Dim> { nextRank, from, current, config });
+        nextRank *= 2;
+      }
+      for (const auto& edge : g.getOutgoingOriginalEdgesOf(current)) {
+        const double next = c + edge.costByConfiguration(config);
+        if (next < cost[edge.end]) {
+          cost[edge.end] = next;
+          heap.emplace(next, edge.end);
+        }
+      }
+    }
+  }
+  return queries;
+}
+
+// One query per line: rank, source, target and the configuration.
+template <int Dim>
+void writeRankQueries(std::ostream& out, const std::vector<RankQuery<Dim>>& queries)
+{
+  out << std::setprecision(std::numeric_limits<double>::max_digits10);
+  for (const auto& q : queries) {
+    out << q.rank << ' ' << q.from << ' ' << q.to;
+    for (const auto& value : q.config.values) {
+      out << ' ' << value;
+    }
+    out << '\n';
+  }
+}
+
+// Reads queries written by writeRankQueries for a graph with nodeCount nodes.
+template <int Dim>
+std::vector<RankQuery<Dim>> readRankQueries(std::istream& in, size_t nodeCount)
+{
+  std::vector<RankQuery<Dim>> queries;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    std::istringstream text { line };
+    size_t rank;
+    uint32_t from;
+    uint32_t to;
+    std::vector<double> values(Dim);
+    text >> rank >> from >> to;
+    for (auto& value : values) {
+      text >> value;
+    }
+    if (!text) {
+      throw std::invalid_argument("Invalid rank query: " + line);
+    }
+    if (from >= nodeCount || to >= nodeCount) {
+      throw std::invalid_argument("Rank query outside of the graph: " + line);
+    }
+    queries.push_back(RankQuery<Dim> { rank, NodePos { from }, NodePos { to }, values });
+  }
+  return queries;
+}
+
+#endif /* DIJKSTRA_RANK_H */
@@ -20,70 +20,196 @@
 
 #include "graph.hpp"
 
-#include <map>
+#include <algorithm>
+#include <future>
 #include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
+// Counts how many routes use each edge. The counts are stored densely for
+// the range of edge ids seen so far, the range grows with the added routes.
 template <int Dim> class EdgeLoads {
   public:
   using RouteD = Route<Dim>;
 
-  EdgeLoads() = delete;
+  EdgeLoads() = default;
   EdgeLoads(const EdgeLoads& other) = default;
   EdgeLoads(EdgeLoads&& other) noexcept = default;
   virtual ~EdgeLoads() noexcept = default;
   EdgeLoads& operator=(const EdgeLoads& other) = default;
   EdgeLoads& operator=(EdgeLoads&& other) noexcept = default;
-  EdgeLoads(const std::vector<RouteD>&);
+  EdgeLoads(const std::vector<RouteD>& routes, size_t threadCount = 0);
 
-  double operator[](EdgeId e);
-  double max_load();
-  double avg_load();
-  void write_csv(std::ostream&);
+  // Every thread counts a part of the routes into its own array, the arrays
+  // are summed up afterwards. A threadCount of 0 uses all cores.
+  void add(const std::vector<RouteD>& routes, size_t threadCount = 0);
+  void add(const RouteD& route);
+
+  double operator[](EdgeId e) const;
+  double max_load() const;
+  double avg_load() const;
+  void write_csv(std::ostream&, size_t threadCount = 0) const;
 
   protected:
   private:
-  std::map<EdgeId, size_t> loads;
-  size_t route_count;
+  // Fewer routes or edges than this per thread are not worth a thread.
+  static constexpr size_t ROUTES_PER_THREAD = 256;
+  static constexpr size_t EDGES_PER_THREAD = 1 << 16;
+
+  static size_t usedThreads(size_t threadCount, size_t work, size_t workPerThread);
+  // Calls f(part, begin, end) for parts of [0, count) on their own threads.
+  template <class F> static void inParallel(size_t count, size_t threadCount, F f);
+  void extendRange(EdgeId min, EdgeId max);
+
+  EdgeId first { 0 };
+  std::vector<uint32_t> loads;
+  size_t route_count = 0;
 };
 
 template <int Dim>
-EdgeLoads<Dim>::EdgeLoads(const std::vector<RouteD>& routes)
-    : route_count(routes.size())
+EdgeLoads<Dim>::EdgeLoads(const std::vector<RouteD>& routes, size_t threadCount)
+{
+  add(routes, threadCount);
+}
+
+template <int Dim>
+size_t EdgeLoads<Dim>::usedThreads(size_t threadCount, size_t work, size_t workPerThread)
+{
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  return std::max<size_t>(1, std::min(threadCount, work / workPerThread));
+}
+
+template <int Dim>
+template <class F>
+void EdgeLoads<Dim>::inParallel(size_t count, size_t threadCount, F f)
+{
+  const size_t chunk = (count + threadCount - 1) / threadCount;
+  std::vector<std::future<void>> futures;
+  for (size_t part = 1; part < threadCount; ++part) {
+    const size_t begin = std::min(count, part * chunk);
+    const size_t end = std::min(count, begin + chunk);
+    futures.push_back(std::async(std::launch::async, f, part, begin, end));
+  }
+  f(0, 0, std::min(count, chunk));
+  for (auto& future : futures) {
+    future.get();
+  }
+}
+
+template <int Dim> void EdgeLoads<Dim>::extendRange(EdgeId min, EdgeId max)
+{
+  if (loads.empty()) {
+    first = min;
+    loads.assign(max - min + 1, 0);
+    return;
+  }
+  const EdgeId newFirst = std::min(first, min);
+  const size_t newSize = std::max<size_t>(first + loads.size(), max + 1) - newFirst;
+  if (newFirst == first) {
+    loads.resize(newSize, 0);
+    return;
+  }
+  std::vector<uint32_t> extended(newSize, 0);
+  std::copy(loads.begin(), loads.end(), extended.begin() + (first - newFirst));
+  loads = std::move(extended);
+  first = newFirst;
+}
+
+template <int Dim> void EdgeLoads<Dim>::add(const std::vector<RouteD>& routes, size_t threadCount)
 {
-  // Optimize away special casing for the empty routes case
-  if (route_count == 0) {
-    route_count = 1;
+  route_count += routes.size();
+  const size_t threads = usedThreads(threadCount, routes.size(), ROUTES_PER_THREAD);
+
+  using Range = std::pair<EdgeId, EdgeId>;
+  std::vector<Range> ranges(threads, Range { EdgeId { std::numeric_limits<uint32_t>::max() }, 0 });
+  inParallel(routes.size(), threads, [&](size_t part, size_t begin, size_t end) {
+    auto& [min, max] = ranges[part];
+    for (size_t i = begin; i < end; ++i) {
+      for (const auto& edge : routes[i].edges) {
+        min = std::min(min, edge);
+        max = std::max(max, edge);
+      }
+    }
+  });
+  bool empty = true;
+  for (const auto& [min, max] : ranges) {
+    if (min <= max) {
+      extendRange(min, max);
+      empty = false;
+    }
+  }
+  if (empty) {
+    return;
   }
-  for (const auto& route : routes) {
-    for (const auto& edge : route.edges) {
-      loads[edge]++;
+
+  // The first part counts into loads directly.
+  std::vector<std::vector<uint32_t>> shards(threads - 1);
+  const size_t size = loads.size();
+  inParallel(routes.size(), threads, [&](size_t part, size_t begin, size_t end) {
+    auto& counts = part == 0 ? loads : shards[part - 1];
+    counts.resize(size, 0);
+    for (size_t i = begin; i < end; ++i) {
+      for (const auto& edge : routes[i].edges) {
+        ++counts[edge - first];
+      }
+    }
+  });
+  if (shards.empty()) {
+    return;
+  }
+  inParallel(loads.size(), threads, [&](size_t, size_t begin, size_t end) {
+    for (const auto& shard : shards) {
+      for (size_t i = begin; i < end; ++i) {
+        loads[i] += shard[i];
+      }
     }
+  });
+}
+
+template <int Dim> void EdgeLoads<Dim>::add(const RouteD& route)
+{
+  ++route_count;
+  if (route.edges.empty()) {
+    return;
+  }
+  const auto [min, max] = std::minmax_element(route.edges.begin(), route.edges.end());
+  extendRange(*min, *max);
+  for (const auto& edge : route.edges) {
+    ++loads[edge - first];
   }
 }
 
-template <int Dim> double EdgeLoads<Dim>::operator[](EdgeId e)
+template <int Dim> double EdgeLoads<Dim>::operator[](EdgeId e) const
 {
-  return static_cast<double>(loads[e]) / route_count;
+  if (e < first || e - first >= loads.size()) {
+    return 0.0;
+  }
+  return static_cast<double>(loads[e - first]) / std::max<size_t>(1, route_count);
 };
 
-template <int Dim> double EdgeLoads<Dim>::max_load()
+template <int Dim> double EdgeLoads<Dim>::max_load() const
 {
-  auto max = *std::max_element(loads.begin(), loads.end(),
-      [](const auto& a, const auto& b) { return std::get<size_t>(a) < std::get<size_t>(b); });
-  return static_cast<double>(std::get<size_t>(max)) / route_count;
+  if (loads.empty()) {
+    return 0.0;
+  }
+  return static_cast<double>(*std::max_element(loads.begin(), loads.end()))
+      / std::max<size_t>(1, route_count);
 }
 
-template <int Dim> double EdgeLoads<Dim>::avg_load()
+template <int Dim> double EdgeLoads<Dim>::avg_load() const
 {
   double sum = 0.0;
   size_t count = 0;
-  for (const auto& [edge_id, load] : loads) {
+  for (const auto& load : loads) {
     if (load == 0) {
       continue;
     }
     ++count;
-    sum += this->operator[](edge_id);
+    sum += static_cast<double>(load) / route_count;
   }
 
   if (count == 0) {
@@ -92,11 +218,24 @@ template <int Dim> double EdgeLoads<Dim>::avg_load()
   return static_cast<double>(sum) / count;
 }
 
-template <int Dim> void EdgeLoads<Dim>::write_csv(std::ostream& out)
+// Every thread formats a part of the edges, the parts are written in order.
+template <int Dim> void EdgeLoads<Dim>::write_csv(std::ostream& out, size_t threadCount) const
 {
+  const size_t threads = usedThreads(threadCount, loads.size(), EDGES_PER_THREAD);
+  std::vector<std::string> parts(threads);
+  inParallel(loads.size(), threads, [&](size_t part, size_t begin, size_t end) {
+    std::ostringstream text;
+    for (size_t i = begin; i < end; ++i) {
+      if (loads[i] > 0) {
+        text << first + i << ',' << loads[i] << '\n';
+      }
+    }
+    parts[part] = text.str();
+  });
+
   out << "edge,routecount" << '\n';
-  for (const auto& [edge, count] : loads) {
-    out << edge << ',' << count << '\n';
+  for (const auto& part : parts) {
+    out << part;
   }
 }
 
@@ -28,6 +28,7 @@
 #include "restriction_policy.hpp"
 #include "routeComparator.hpp"
 #include "similarity_policy.hpp"
+#include "trace.hpp"
 
 #include "ThreadPool.h"
 #include <Eigen/Dense>
@@ -159,6 +160,8 @@ class EnumerateOptimals : public Skills<Dim, EnumerateOptimals<Dim, Skills>> {
   {
     routes.clear();
     configs.clear();
+    dijkstra_count = 0;
+    triangulation_time = 0;
     this->tri_clear();
     this->prio_clear();
     this->sim_clear();
@@ -169,14 +172,18 @@ class EnumerateOptimals : public Skills<Dim, EnumerateOptimals<Dim, Skills>> {
   {
     req_queue.send(r);
     ++pending_requests;
+    ++dijkstra_count;
   }
 
   void addToTriangulation()
   {
+    auto start = c::high_resolution_clock::now();
     auto vertId = routes.size() - 1;
     this->register_route(routes[vertId]);
     auto& routeCosts = routes[vertId].costs;
     this->add_route(routeCosts, vertId);
+    auto end = c::high_resolution_clock::now();
+    triangulation_time += c::duration_cast<c::microseconds>(end - start).count();
   }
 
   std::vector<size_t> extract_independent_set(const std::vector<size_t>& vertices, bool ilp)
@@ -263,14 +270,18 @@ class EnumerateOptimals : public Skills<Dim, EnumerateOptimals<Dim, Skills>> {
   public:
   size_t enumeration_time;
   size_t recommendation_time;
+  // Number of Dijkstra queries and time spent on the triangulation in µs of
+  // the last find().
+  size_t dijkstra_count = 0;
+  size_t triangulation_time = 0;
 
-  EnumerateOptimals(GraphD* g, size_t maxRoutes)
+  EnumerateOptimals(GraphD* g, size_t maxRoutes, size_t threadCount = THREAD_COUNT)
       : g(g)
       , maxRoutes(maxRoutes)
   {
 
-    d.reserve(THREAD_COUNT);
-    for (size_t i = 0; i < THREAD_COUNT; ++i) {
+    d.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
       d.emplace_back(req_queue, g->createDijkstra(), res_queue);
     }
 
@@ -288,6 +299,7 @@ class EnumerateOptimals : public Skills<Dim, EnumerateOptimals<Dim, Skills>> {
 
   void find(NodePos s, NodePos t)
   {
+    TraceSpan span { "enumerate" };
     auto start = c::high_resolution_clock::now();
     clear();
 
@@ -319,7 +331,11 @@ class EnumerateOptimals : public Skills<Dim, EnumerateOptimals<Dim, Skills>> {
     std::vector<typename TDS::Full_cell> q;
     while (routes.size() < maxRoutes) {
       q.clear();
+      auto hullStart = c::high_resolution_clock::now();
       this->get_convex_hull_cells(q);
+      triangulation_time
+          += c::duration_cast<c::microseconds>(c::high_resolution_clock::now() - hullStart)
+                 .count();
       if (q.empty() && pending_requests == 0) {
         break;
       }
@@ -356,6 +372,9 @@ class EnumerateOptimals : public Skills<Dim, EnumerateOptimals<Dim, Skills>> {
     auto end = c::high_resolution_clock::now();
 
     enumeration_time = c::duration_cast<c::milliseconds>(end - start).count();
+    span.field("routes", routes.size());
+    span.field("dijkstra_queries", dijkstra_count);
+    span.field("triangulation_us", triangulation_time);
   }
 
   size_t found_route_count() const { return routes.size(); }
@@ -363,6 +382,7 @@ class EnumerateOptimals : public Skills<Dim, EnumerateOptimals<Dim, Skills>> {
 
   std::tuple<std::vector<RouteD>, std::vector<ConfigD>> recommend_routes(bool ilp)
   {
+    TraceSpan span { "recommend" };
     auto [vertices, edges] = this->vertex_ids_and_edges();
     auto independent_set = extract_independent_set(vertices, ilp);
 
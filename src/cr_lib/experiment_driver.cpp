@@ -0,0 +1,78 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "experiment_driver.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+std::vector<std::string> splitRow(const std::string& line)
+{
+  std::vector<std::string> values(1);
+  bool quoted = false;
+  for (char c : line) {
+    if (c == '"') {
+      quoted = !quoted;
+    }
+    if (c == ',' && !quoted) {
+      values.emplace_back();
+    } else {
+      values.back() += c;
+    }
+  }
+  return values;
+}
+}
+
+std::unordered_set<std::string> readDoneKeys(std::istream& in, const std::vector<size_t>& columns)
+{
+  std::unordered_set<std::string> keys;
+  std::string line;
+  if (!std::getline(in, line)) {
+    return keys;
+  }
+  // Rows cut off by an aborted run are done again.
+  const size_t columnCount = splitRow(line).size();
+  while (std::getline(in, line)) {
+    const auto values = splitRow(line);
+    if (values.size() < columnCount
+        || std::any_of(columns.begin(), columns.end(),
+            [&values](size_t column) { return column >= values.size(); })) {
+      continue;
+    }
+    std::string key;
+    for (size_t i = 0; i < columns.size(); ++i) {
+      key += (i == 0 ? "" : ",") + values[columns[i]];
+    }
+    keys.insert(key);
+  }
+  return keys;
+}
+
+std::streamoff completeRowsLength(std::istream& in)
+{
+  std::streamoff length = 0;
+  std::streamoff read = 0;
+  for (std::istreambuf_iterator<char> c { in }, end; c != end; ++c) {
+    ++read;
+    if (*c == '\n') {
+      length = read;
+    }
+  }
+  return length;
+}
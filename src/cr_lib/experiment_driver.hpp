@@ -0,0 +1,124 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef EXPERIMENT_DRIVER_H
+#define EXPERIMENT_DRIVER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// One s-t pair or parameter combination of an experiment. run returns the
+// CSV row of the job or an empty string if there is nothing to write. key
+// has to match the key columns of that row, see csvKey.
+template <class State> struct ExperimentJob {
+  std::string key;
+  std::function<std::string(State&)> run;
+};
+
+// Joins the columns with commas, formatted like rows written by ostreams.
+template <class... Columns> std::string csvKey(const Columns&... columns)
+{
+  std::ostringstream key;
+  size_t i = 0;
+  ((key << (i++ == 0 ? "" : ",") << columns), ...);
+  return key.str();
+}
+
+// Keys of the rows in a CSV file with a header, made of the given columns.
+// Commas in double quotes do not split columns. Rows with fewer columns than
+// the header are left out.
+std::unordered_set<std::string> readDoneKeys(std::istream& in, const std::vector<size_t>& columns);
+
+// Length of in up to and including its last newline. A run that was killed
+// can leave a partial row behind it, which has to go before rows are appended.
+std::streamoff completeRowsLength(std::istream& in);
+
+// Runs the jobs on threadCount threads, each with its own state from
+// makeState, and writes the rows to out in the order of the jobs. Workers
+// publish rows into per-job slots through an atomic flag, the calling thread
+// writes finished slots in order. Jobs whose key is in done are skipped.
+// Returns the number of jobs run.
+template <class State, class MakeState>
+size_t runExperiment(const std::vector<ExperimentJob<State>>& jobs,
+    const std::unordered_set<std::string>& done, std::ostream& out, size_t threadCount,
+    MakeState makeState)
+{
+  std::vector<size_t> open;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    if (done.count(jobs[i].key) == 0) {
+      open.push_back(i);
+    }
+  }
+  if (open.size() < jobs.size()) {
+    std::cout << "skipping " << jobs.size() - open.size() << " finished jobs" << '\n';
+  }
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threadCount = std::max<size_t>(1, std::min(threadCount, open.size()));
+
+  std::vector<std::string> rows(open.size());
+  auto ready = std::make_unique<std::atomic<bool>[]>(open.size());
+  std::atomic<size_t> next { 0 };
+  auto work = [&]() {
+    State state = makeState();
+    for (size_t i = next++; i < open.size(); i = next++) {
+      const auto& job = jobs[open[i]];
+      try {
+        rows[i] = job.run(state);
+      } catch (std::exception& e) {
+        std::cerr << "job " << job.key << " failed: " << e.what() << '\n';
+      } catch (...) {
+        std::cerr << "job " << job.key << " failed" << '\n';
+      }
+      ready[i].store(true, std::memory_order_release);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threadCount; ++i) {
+    workers.emplace_back(work);
+  }
+
+  for (size_t i = 0; i < open.size(); ++i) {
+    if (!ready[i].load(std::memory_order_acquire)) {
+      out.flush();
+      while (!ready[i].load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    out << rows[i];
+    std::string().swap(rows[i]);
+    if ((i + 1) % 100 == 0) {
+      std::cout << "finished " << i + 1 << " of " << open.size() << " jobs" << '\n';
+    }
+  }
+  out.flush();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return open.size();
+}
+
+#endif /* EXPERIMENT_DRIVER_H */
@@ -18,21 +18,25 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
+#include "ids.hpp"
 #include "namedType.hpp"
 #include "serialize_optional.hpp"
 #include <atomic>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <deque>
 #include <set>
 #include <unordered_set>
 #include <vector>
 
 using NodeId = NamedType<uint32_t, struct NodeIdParameter>;
 using NodePos = NamedType<uint32_t, struct NodePosParameter>;
-using EdgeId = NamedType<uint32_t, struct EdgeParameter>;
 using Lat = NamedType<double, struct LatParameter>;
 using Lng = NamedType<double, struct LngParameter>;
 using Height = NamedType<double, struct HeightParameter>;
@@ -76,6 +80,15 @@ template <int Dim> struct Cost {
   }
   double operator*(const ConfigD& conf) const;
 
+  CostD operator*(double factor) const
+  {
+    double newValues[Dim];
+    for (size_t i = 0; i < Dim; ++i) {
+      newValues[i] = values[i] * factor;
+    }
+    return newValues;
+  };
+
   CostD operator+(const CostD& c) const
   {
     double newValues[Dim];
@@ -171,36 +184,21 @@ template <int Dim> class Edge {
 
   NodeId getSourceId() const;
   NodeId getDestId() const;
-
-  static NodeId getSourceId(EdgeId i);
-  static NodeId getDestId(EdgeId i);
   const ReplacedEdge& getEdgeA() const;
   const ReplacedEdge& getEdgeB() const;
 
-  static const ReplacedEdge& getEdgeA(EdgeId i);
-  static const ReplacedEdge& getEdgeB(EdgeId i);
-
   NodePos sourcePos() const;
   NodePos destPos() const;
   void sourcePos(NodePos source);
   void destPos(NodePos dest);
-  static NodePos sourcePos(EdgeId i);
-  static NodePos destPos(EdgeId i);
-  static void sourcePos(EdgeId i, NodePos source);
-  static void destPos(EdgeId i, NodePos dest);
 
   EdgeId getId() const;
   void setId(EdgeId id);
   const CostD& getCost() const;
-  static const CostD& getCost(EdgeId id);
   double costByConfiguration(const ConfigD& conf) const;
   void setCost(CostD c);
 
-  static HalfEdgeD makeHalfEdge(EdgeId id, NodePos begin, NodePos end);
-
   static Edge createFromText(std::istream& text);
-  static std::vector<EdgeId> administerEdges(std::vector<Edge>&& edges);
-  static const Edge getEdge(EdgeId id);
 
   template <int D>
   friend void testEdgeInternals(const Edge<D>& e, NodeId source, NodeId destination, Length length,
@@ -219,15 +217,6 @@ template <int Dim> class Edge {
   NodePos sourcePos_;
   NodePos destPos_;
 
-  static std::vector<EdgeId> internalId_vec;
-  static std::vector<NodeId> source_vec;
-  static std::vector<NodeId> destination_vec;
-  static std::vector<CostD> cost_vec;
-  static std::vector<ReplacedEdge> edgeA_vec;
-  static std::vector<ReplacedEdge> edgeB_vec;
-  static std::vector<NodePos> sourcePos__vec;
-  static std::vector<NodePos> destPos__vec;
-
   template <class Archive> void serialize(Archive& ar, const unsigned int /*version*/)
   {
     ar& internalId;
@@ -239,6 +228,53 @@ template <int Dim> class Edge {
   }
 };
 
+// Edge data of one graph, stored column by column. Edge ids index into it, so
+// the ids of a graph are 0 to its edge count and every graph frees its edges
+// with itself.
+template <int Dim> class EdgeStorage {
+  public:
+  using EdgeD = Edge<Dim>;
+  using CostD = Cost<Dim>;
+  using HalfEdgeD = HalfEdge<Dim>;
+
+  EdgeStorage() = default;
+  // Edges come without ids from graph files or with the consecutive ids they
+  // had when they were saved. Replaced edges are given relative to the first
+  // of them.
+  explicit EdgeStorage(std::vector<EdgeD>&& edges);
+
+  size_t size() const { return source_vec.size(); }
+
+  NodeId getSourceId(EdgeId id) const { return source_vec[id]; }
+  NodeId getDestId(EdgeId id) const { return destination_vec[id]; }
+  const ReplacedEdge& getEdgeA(EdgeId id) const { return edgeA_vec[id]; }
+  const ReplacedEdge& getEdgeB(EdgeId id) const { return edgeB_vec[id]; }
+
+  NodePos sourcePos(EdgeId id) const { return sourcePos__vec[id]; }
+  NodePos destPos(EdgeId id) const { return destPos__vec[id]; }
+  void sourcePos(EdgeId id, NodePos source) { sourcePos__vec[id] = source; }
+  void destPos(EdgeId id, NodePos dest) { destPos__vec[id] = dest; }
+
+  const CostD& getCost(EdgeId id) const { return cost_vec[id]; }
+  void setCost(EdgeId id, CostD c) { cost_vec[id] = c; }
+
+  HalfEdgeD makeHalfEdge(EdgeId id, NodePos end) const;
+  EdgeD getEdge(EdgeId id) const;
+
+  // Appends the original edges of the shortcut e to route, in front of or
+  // behind the edges already there.
+  void unpack(EdgeId e, std::deque<EdgeId>& route, bool front) const;
+
+  private:
+  std::vector<NodeId> source_vec;
+  std::vector<NodeId> destination_vec;
+  std::vector<CostD> cost_vec;
+  std::vector<ReplacedEdge> edgeA_vec;
+  std::vector<ReplacedEdge> edgeB_vec;
+  std::vector<NodePos> sourcePos__vec;
+  std::vector<NodePos> destPos__vec;
+};
+
 class Node {
   public:
   Node() = default;
@@ -279,11 +315,28 @@ class Node {
   }
 };
 
+template <int Dim> struct CostUpdate {
+  EdgeId edge;
+  Cost<Dim> cost;
+};
+
+struct RecustomizationResult {
+  size_t updatedEdges = 0;
+  size_t updatedShortcuts = 0;
+  // Edges which got more expensive in some criterion, or cheaper between
+  // nodes of different levels. Shortcuts left out during contraction may
+  // have relied on them as witnesses or may now beat their witnesses, only a
+  // new contraction guarantees exact results then.
+  std::vector<EdgeId> flagged;
+};
+
 class Grid;
+class SegmentIndex;
 template <int Dim> class EdgeRange;
 template <int Dim> class Graph {
   public:
   using EdgeD = Edge<Dim>;
+  using EdgeStorageD = EdgeStorage<Dim>;
   using HalfEdgeD = HalfEdge<Dim>;
   using CostD = Cost<Dim>;
   using EdgeRangeD = EdgeRange<Dim>;
@@ -291,7 +344,6 @@ template <int Dim> class Graph {
   using NormalDijkstraD = NormalDijkstra<Dim>;
 
   Graph(std::vector<Node>&& nodes, std::vector<EdgeD>&& edges);
-  Graph(std::vector<Node>&& nodes, std::vector<EdgeId>&& edges);
   Graph(const Graph& other) = delete;
   Graph(Graph&& other) noexcept = default;
   virtual ~Graph() noexcept = default;
@@ -303,10 +355,20 @@ template <int Dim> class Graph {
   std::vector<NodeOffset> const& getOffsets() const;
   DijkstraD createDijkstra();
   NormalDijkstraD createNormalDijkstra(bool unpack = false);
-  Grid createGrid(uint32_t sideLength = 100) const;
-
+  Grid createGrid() const;
+  SegmentIndex createSegmentIndex() const;
+  // Shared indices, built on first use unless they were loaded with the graph.
+  const Grid& getGrid() const;
+  const SegmentIndex& getSegmentIndex() const;
+
+  // Data of the edges by their id, shortcuts included.
+  const EdgeStorageD& getEdges() const { return edges; }
   EdgeRangeD getOutgoingEdgesOf(NodePos pos) const;
   EdgeRangeD getIngoingEdgesOf(NodePos pos) const;
+  // Edges without the shortcuts, for searches on the uncontracted graph.
+  // Built on first use.
+  EdgeRangeD getOutgoingOriginalEdgesOf(NodePos pos) const;
+  EdgeRangeD getIngoingOriginalEdgesOf(NodePos pos) const;
 
   size_t getLevelOf(NodePos pos) const;
 
@@ -327,11 +389,16 @@ template <int Dim> class Graph {
   NodePos getNodePos(const Node* n) const;
   uint32_t get_max_level();
 
+  // Sets new costs for original edges and recomputes the shortcuts depending
+  // on them, level by level from the bottom. Not safe while queries run.
+  RecustomizationResult updateCosts(
+      const std::vector<CostUpdate<Dim>>& updates, size_t threadCount = 0);
+
   private:
   friend class boost::serialization::access;
 
-  void init(std::vector<Node>&& nodes, std::vector<EdgeId>&& edges);
-  void connectEdgesToNodes(const std::vector<Node>& nodes, const std::vector<EdgeId>& edges);
+  void init(std::vector<Node>&& nodes);
+  void connectEdgesToNodes(const std::vector<Node>& nodes);
 
   static size_t readCount(std::istream& file);
 
@@ -341,34 +408,70 @@ template <int Dim> class Graph {
   std::vector<HalfEdgeD> outEdges;
   std::vector<uint32_t> level;
   uint32_t _max_level = 0;
+  EdgeStorageD edges;
   size_t edgeCount;
 
+  struct SpatialIndices {
+    std::once_flag gridBuilt;
+    std::once_flag segmentsBuilt;
+    std::unique_ptr<Grid> grid;
+    std::unique_ptr<SegmentIndex> segments;
+  };
+  std::shared_ptr<SpatialIndices> spatialIndices = std::make_shared<SpatialIndices>();
+
+  struct OriginalEdges {
+    std::once_flag built;
+    std::vector<NodeOffset> offsets;
+    std::vector<HalfEdgeD> inEdges;
+    std::vector<HalfEdgeD> outEdges;
+  };
+  std::shared_ptr<OriginalEdges> originalEdges = std::make_shared<OriginalEdges>();
+  const OriginalEdges& getOriginalEdges() const;
+
+  // Version 1 stores the spatial indices after the edges, version 0 files
+  // build them on first use.
   template <class Archive> void save(Archive& ar, const unsigned int /*version*/) const
   {
     ar& nodes;
-    std::vector<EdgeD> edges {};
-    edges.reserve(edgeCount);
-    for (const auto& e : inEdges) {
-      edges.push_back(EdgeD::getEdge(e.id));
+    std::vector<EdgeD> savedEdges {};
+    savedEdges.reserve(edgeCount);
+    for (uint32_t i = 0; i < edgeCount; ++i) {
+      savedEdges.push_back(edges.getEdge(EdgeId { i }));
     }
-    std::sort(edges.begin(), edges.end(),
-        [](const auto& left, const auto& right) { return left.getId() < right.getId(); });
-    ar& edges;
+    ar& savedEdges;
+    ar& getGrid();
+    ar& getSegmentIndex();
   }
 
-  template <class Archive> void load(Archive& ar, const unsigned int /*version*/)
+  template <class Archive> void load(Archive& ar, const unsigned int version)
   {
     std::vector<Node> nodes;
-    std::vector<EdgeD> edges;
+    std::vector<EdgeD> loadedEdges;
     ar& nodes;
-    ar& edges;
-    std::sort(edges.begin(), edges.end(),
+    ar& loadedEdges;
+    std::sort(loadedEdges.begin(), loadedEdges.end(),
         [](const auto& left, const auto& right) { return left.getId() < right.getId(); });
-    *this = Graph(std::move(nodes), std::move(edges));
+    const EdgeId firstInFile
+        = loadedEdges.empty() ? EdgeId { 0 } : loadedEdges.front().getId();
+    *this = Graph(std::move(nodes), std::move(loadedEdges));
+    if (version >= 1) {
+      loadSpatialIndices(ar, firstInFile);
+    }
   }
+  template <class Archive> void loadSpatialIndices(Archive& ar, EdgeId firstInFile);
   BOOST_SERIALIZATION_SPLIT_MEMBER()
 };
 
+namespace boost {
+namespace serialization {
+  template <int Dim> struct version<Graph<Dim>> {
+    using type = mpl::int_<1>;
+    using tag = mpl::integral_c_tag;
+    BOOST_STATIC_CONSTANT(int, value = version::type::value);
+  };
+}
+}
+
 template <int Dim> class EdgeRange {
   public:
   using HalfEdgeD = HalfEdge<Dim>;
@@ -394,11 +497,10 @@ template <int Dim> class EdgeRange {
   iterator end_;
 };
 
-template <int Dim> struct RouteWithCount;
 template <int Dim> struct Route;
 
 template <int Dim>
-void printRoutes(std::ofstream& dotFile, const Graph<Dim>& graph, const RouteWithCount<Dim>& route1,
+void printRoutes(std::ofstream& dotFile, const Graph<Dim>& graph, const Route<Dim>& route1,
     const Route<Dim>& route2, const Config<Dim>& config, const std::set<NodePos>& set = {});
 
 #include "edge.inc"
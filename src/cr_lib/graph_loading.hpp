@@ -22,6 +22,7 @@
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
 using ms = std::chrono::milliseconds;
 namespace iostr = boost::iostreams;
@@ -65,3 +66,31 @@ template <int Dim> Graph<Dim> loadGraphFromBinaryFile(std::string& graphPath)
             << "ms" << '\n';
   return g;
 }
+
+// Reads lines of an edge id followed by its Dim new costs.
+template <int Dim> std::vector<CostUpdate<Dim>> loadCostUpdates(std::string& path)
+{
+  std::ifstream file { path };
+  if (!file) {
+    throw std::runtime_error("Could not open " + path);
+  }
+  std::vector<CostUpdate<Dim>> updates;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    std::istringstream text { line };
+    uint32_t id;
+    std::vector<double> values(Dim);
+    text >> id;
+    for (auto& value : values) {
+      text >> value;
+    }
+    if (!text || *std::min_element(values.begin(), values.end()) < 0) {
+      throw std::invalid_argument("Invalid cost update: " + line);
+    }
+    updates.push_back(CostUpdate<Dim> { EdgeId { id }, Cost<Dim> { values } });
+  }
+  return updates;
+}
@@ -18,163 +18,286 @@
 #include "grid.hpp"
 
 #include "graph.hpp"
+#include <algorithm>
 #include <cmath>
+#include <future>
+#include <thread>
+
+namespace {
+const double EARTH_RADIUS = 6371007.2;
+}
 
 double haversine_distance(const PositionalNode& a, const PositionalNode& b)
 {
-  const double EARTH_RADIUS = 6371007.2;
   const double RADIANS_CONVERSION = M_PI / 180;
-  using namespace std;
-
-  double theta1 = a.lat * RADIANS_CONVERSION;
-  double theta2 = b.lat * RADIANS_CONVERSION;
-  double deltaTheta = (b.lat - a.lat) * RADIANS_CONVERSION;
-  double deltaLambda = (b.lng - a.lng) * RADIANS_CONVERSION;
-  double e = pow(sin(deltaTheta / 2), 2)
-      + std::cos(theta1) * std::cos(theta2) * pow(sin(deltaLambda / 2), 2);
-  double c = 2 * asin(sqrt(e));
-  return EARTH_RADIUS * c;
+
+  const double theta1 = a.lat * RADIANS_CONVERSION;
+  const double theta2 = b.lat * RADIANS_CONVERSION;
+  const double sinDeltaTheta = std::sin((b.lat - a.lat) * RADIANS_CONVERSION / 2);
+  const double sinDeltaLambda = std::sin((b.lng - a.lng) * RADIANS_CONVERSION / 2);
+  const double e = sinDeltaTheta * sinDeltaTheta
+      + std::cos(theta1) * std::cos(theta2) * sinDeltaLambda * sinDeltaLambda;
+  return 2 * EARTH_RADIUS * std::asin(std::min(1.0, std::sqrt(e)));
 }
 
-Grid::Grid(const std::vector<Node>& nodes, long sideLength)
-    : sideLength(sideLength)
+double chord_to_distance(double squaredChord)
 {
-  if (sideLength < 0) {
-    throw std::invalid_argument("Side length has to be positive");
-  }
+  return 2 * EARTH_RADIUS * std::asin(std::min(1.0, std::sqrt(squaredChord) / 2));
+}
+
+std::array<double, 3> unit_vector(Lat lat, Lng lng)
+{
+  const double RADIANS_CONVERSION = M_PI / 180;
+  const double theta = lat * RADIANS_CONVERSION;
+  const double lambda = lng * RADIANS_CONVERSION;
+  return { std::cos(theta) * std::cos(lambda), std::cos(theta) * std::sin(lambda),
+    std::sin(theta) };
+}
+
+LatLng from_unit_vector(const std::array<double, 3>& v)
+{
+  const double DEGREES_CONVERSION = 180 / M_PI;
+  const double horizontal = std::hypot(v[0], v[1]);
+  return LatLng { Lat { std::atan2(v[2], horizontal) * DEGREES_CONVERSION },
+    Lng { std::atan2(v[1], v[0]) * DEGREES_CONVERSION } };
+}
 
+Grid::Grid(const std::vector<Node>& nodes)
+{
+  std::vector<Point> points;
+  points.reserve(nodes.size());
   for (uint32_t i = 0; i < nodes.size(); ++i) {
     const auto& node = nodes[i];
-    this->nodes.emplace_back(node.lat(), node.lng(), NodePos { i });
+    PositionalNode positional { node.lat(), node.lng(), NodePos { i } };
+    bBox.addNode(positional);
+    points.push_back(Point { unit_vector(node.lat(), node.lng()), NodePos { i } });
   }
 
-  std::for_each(
-      this->nodes.begin(), this->nodes.end(), [this](auto& pos) { this->bBox.addNode(pos); });
+  // All leaves are on the same level, which allows the implicit layout of a
+  // complete binary tree.
+  leafLevel = 0;
+  while ((points.size() >> leafLevel) > LEAF_SIZE) {
+    ++leafLevel;
+  }
+  tree.resize((size_t { 2 } << leafLevel) - 1);
 
-  std::sort(this->nodes.begin(), this->nodes.end(), [this](const auto& a, const auto& b) {
-    return this->coordsToIndex(a.lat, a.lng) < coordsToIndex(b.lat, b.lng);
-  });
-  offset = std::vector<size_t>(sideLength * sideLength + 1, 0);
+  size_t parallelLevels = 0;
+  while ((size_t { 1 } << parallelLevels) < std::thread::hardware_concurrency()) {
+    ++parallelLevels;
+  }
+  build(points, 0, 0, 0, points.size(), parallelLevels);
 
-  size_t current = 0;
-  for (size_t i = 0; i < this->nodes.size(); ++i) {
-    const auto& node = this->nodes[i];
-    size_t newIndex = coordsToIndex(node.lat, node.lng);
-    if (newIndex != current) {
-      for (size_t j = current + 1; j < newIndex + 1; ++j) {
-        offset[j] = i;
-      }
-      current = newIndex;
-    }
+  // Leaves are scanned coordinate by coordinate, which the compiler vectorizes.
+  for (auto& c : coords) {
+    c.reserve(points.size());
   }
-  for (size_t i = current + 1; i < offset.size(); ++i) {
-    offset[i] = this->nodes.size();
+  positions.reserve(points.size());
+  for (const auto& p : points) {
+    for (size_t d = 0; d < 3; ++d) {
+      coords[d].push_back(p.coords[d]);
+    }
+    positions.push_back(p.pos);
   }
-  offset[offset.size() - 1] = this->nodes.size();
 }
 
-std::optional<NodePos> Grid::findNextNode(Lat lat, Lng lng)
+void Grid::build(std::vector<Point>& points, size_t node, size_t level, size_t begin, size_t end,
+    size_t parallelLevels)
 {
-  auto xyToIndex = [this](size_t x, size_t y) {
-    size_t index = y * sideLength + x;
-    return index;
-  };
-  auto indexToXy = [this](size_t index) {
-    size_t y = index / sideLength;
-    size_t x = index - y * sideLength;
-    return std::make_pair(x, y);
-  };
-  NodePos dummy { 0 };
-
-  auto sideLength = static_cast<double>(this->sideLength);
+  auto& treeNode = tree[node];
+  treeNode.begin = begin;
+  treeNode.end = end;
+  treeNode.min.fill(std::numeric_limits<double>::max());
+  treeNode.max.fill(std::numeric_limits<double>::lowest());
+  for (size_t i = begin; i < end; ++i) {
+    for (size_t d = 0; d < 3; ++d) {
+      treeNode.min[d] = std::min(treeNode.min[d], points[i].coords[d]);
+      treeNode.max[d] = std::max(treeNode.max[d], points[i].coords[d]);
+    }
+  }
+  if (level == leafLevel) {
+    return;
+  }
 
-  const double cell_width = haversine_distance(PositionalNode { bBox.lat_max, bBox.lng_max, dummy },
-                                PositionalNode { bBox.lat_min, bBox.lng_max, dummy })
-      / sideLength;
-  const double cell_height
-      = haversine_distance(PositionalNode { bBox.lat_max, bBox.lng_max, dummy },
-            PositionalNode { bBox.lat_max, bBox.lng_min, dummy })
-      / sideLength;
+  size_t splitDim = 0;
+  for (size_t d = 1; d < 3; ++d) {
+    if (treeNode.max[d] - treeNode.min[d] > treeNode.max[splitDim] - treeNode.min[splitDim]) {
+      splitDim = d;
+    }
+  }
+  const size_t mid = begin + (end - begin) / 2;
+  std::nth_element(points.begin() + begin, points.begin() + mid, points.begin() + end,
+      [splitDim](const Point& a, const Point& b) { return a.coords[splitDim] < b.coords[splitDim]; });
 
-  const auto cell_measure = std::min(cell_width, cell_height);
+  if (level < parallelLevels) {
+    auto left = std::async(std::launch::async,
+        [this, &points, node, level, begin, mid, parallelLevels]() {
+          build(points, 2 * node + 1, level + 1, begin, mid, parallelLevels);
+        });
+    build(points, 2 * node + 2, level + 1, mid, end, parallelLevels);
+    left.get();
+  } else {
+    build(points, 2 * node + 1, level + 1, begin, mid, parallelLevels);
+    build(points, 2 * node + 2, level + 1, mid, end, parallelLevels);
+  }
+}
 
-  PositionalNode target { lat, lng, NodePos { 0 } };
-  const size_t center = coordsToIndex(lat, lng);
-  const auto coord = indexToXy(center);
-  const long& x = coord.first;
-  const long& y = coord.second;
-  long radius = 0;
+double Grid::boxDistance(const TreeNode& node, const std::array<double, 3>& target) const
+{
+  double dist = 0;
+  for (size_t d = 0; d < 3; ++d) {
+    double delta = 0;
+    if (target[d] < node.min[d]) {
+      delta = node.min[d] - target[d];
+    } else if (target[d] > node.max[d]) {
+      delta = target[d] - node.max[d];
+    }
+    dist += delta * delta;
+  }
+  return dist;
+}
 
-  std::optional<double> foundDist = {};
-  std::optional<NodePos> foundIndex = {};
+std::optional<NodePos> Grid::findNextNode(Lat lat, Lng lng) const
+{
+  if (positions.empty()) {
+    return {};
+  }
+  const auto target = unit_vector(lat, lng);
 
-  size_t minDist = 0;
+  struct Candidate {
+    size_t node;
+    size_t level;
+    double dist;
+  };
+  // Depth first search visiting the closer child first. At most two entries
+  // per level are on the stack.
+  std::array<Candidate, 2 * 64> stack;
+  size_t stackSize = 0;
+  stack[stackSize++] = Candidate { 0, 0, boxDistance(tree[0], target) };
 
-  while (radius < this->sideLength) {
-    if (foundDist && foundDist < minDist) {
-      break;
+  double bestDist = std::numeric_limits<double>::max();
+  std::optional<NodePos> best = {};
+  while (stackSize > 0) {
+    const auto candidate = stack[--stackSize];
+    if (candidate.dist >= bestDist) {
+      continue;
     }
-    minDist = radius * cell_measure;
-    for (long yi = y - radius; yi <= y + radius; ++yi) {
-      for (long xi = x - radius; xi <= x + radius; ++xi) {
-        if (!(std::abs(static_cast<long>(xi - x)) == radius
-                || std::abs(static_cast<long>(yi - y)) == radius)
-            || xi >= this->sideLength || yi >= this->sideLength || xi < 0 || yi < 0) {
-
-          continue;
-        }
-        auto index = xyToIndex(xi, yi);
-        for (size_t i = offset[index]; i < offset[index + 1]; ++i) {
-          const auto& node = nodes[i];
-          double dist = haversine_distance(target, node);
-          if (!foundDist || dist < foundDist) {
-            foundDist = dist;
-            foundIndex = node.pos;
-          }
+
+    const auto& treeNode = tree[candidate.node];
+    if (candidate.level == leafLevel) {
+      const size_t count = treeNode.end - treeNode.begin;
+      const double* x = coords[0].data() + treeNode.begin;
+      const double* y = coords[1].data() + treeNode.begin;
+      const double* z = coords[2].data() + treeNode.begin;
+      std::array<double, MAX_LEAF_SIZE> dists;
+      for (size_t i = 0; i < count; ++i) {
+        const double dx = x[i] - target[0];
+        const double dy = y[i] - target[1];
+        const double dz = z[i] - target[2];
+        dists[i] = dx * dx + dy * dy + dz * dz;
+      }
+      for (size_t i = 0; i < count; ++i) {
+        if (dists[i] < bestDist) {
+          bestDist = dists[i];
+          best = positions[treeNode.begin + i];
         }
       }
+      continue;
     }
 
-    ++radius;
+    const size_t left = 2 * candidate.node + 1;
+    const size_t right = left + 1;
+    const double leftDist = boxDistance(tree[left], target);
+    const double rightDist = boxDistance(tree[right], target);
+    const Candidate leftCandidate { left, candidate.level + 1, leftDist };
+    const Candidate rightCandidate { right, candidate.level + 1, rightDist };
+    if (leftDist < rightDist) {
+      stack[stackSize++] = rightCandidate;
+      stack[stackSize++] = leftCandidate;
+    } else {
+      stack[stackSize++] = leftCandidate;
+      stack[stackSize++] = rightCandidate;
+    }
   }
 
-  if (foundIndex) {
-    return foundIndex;
-  }
-  return {};
+  return best;
+}
+
+namespace {
+// Spreads the lower 32 bits of v to the even bit positions.
+uint64_t spreadBits(uint64_t v)
+{
+  v &= 0xFFFFFFFF;
+  v = (v | (v << 16)) & 0x0000FFFF0000FFFF;
+  v = (v | (v << 8)) & 0x00FF00FF00FF00FF;
+  v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0F;
+  v = (v | (v << 2)) & 0x3333333333333333;
+  v = (v | (v << 1)) & 0x5555555555555555;
+  return v;
 }
 
-size_t Grid::coordsToIndex(Lat lat, Lng lng)
+uint64_t mortonCode(const LatLng& coordinate)
 {
-  double cell_width = (bBox.lat_max - bBox.lat_min) / static_cast<double>(sideLength);
-  double cell_height = (bBox.lng_max - bBox.lng_min) / static_cast<double>(sideLength);
-  double lat_dif = lat - bBox.lat_min;
-  double lng_dif = lng - bBox.lng_min;
-  auto x = static_cast<long>(lat_dif / cell_width);
-  auto y = static_cast<long>(lng_dif / cell_height);
-  if (x == sideLength) {
-    x -= 1;
-  }
-  if (y == sideLength) {
-    y -= 1;
-  }
-  return NodePos { static_cast<uint32_t>(y * sideLength + x) };
+  const double SCALE = 4294967295.0;
+  auto quantize = [SCALE](double value, double min, double range) {
+    return static_cast<uint64_t>(std::clamp((value - min) / range, 0.0, 1.0) * SCALE);
+  };
+  return (spreadBits(quantize(coordinate.lat, -90, 180)) << 1)
+      | spreadBits(quantize(coordinate.lng, -180, 360));
+}
 }
 
-BoundingBox Grid::bounding_box() { return bBox; }
+std::vector<std::optional<NodePos>> Grid::findNextNodes(
+    const std::vector<LatLng>& coordinates, size_t threadCount) const
+{
+  std::vector<std::pair<uint64_t, uint32_t>> order;
+  order.reserve(coordinates.size());
+  for (uint32_t i = 0; i < coordinates.size(); ++i) {
+    order.emplace_back(mortonCode(coordinates[i]), i);
+  }
+  std::sort(order.begin(), order.end());
+
+  std::vector<std::optional<NodePos>> result(coordinates.size());
+  auto work = [this, &coordinates, &order, &result](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const auto& coordinate = coordinates[order[i].second];
+      result[order[i].second] = findNextNode(coordinate.lat, coordinate.lng);
+    }
+  };
+
+  // Small batches are not worth starting threads for.
+  const size_t MIN_CHUNK_SIZE = 1024;
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threadCount = std::min(threadCount, (order.size() + MIN_CHUNK_SIZE - 1) / MIN_CHUNK_SIZE);
+  if (threadCount <= 1) {
+    work(0, order.size());
+    return result;
+  }
+
+  std::vector<std::future<void>> futures;
+  const size_t chunkSize = (order.size() + threadCount - 1) / threadCount;
+  for (size_t begin = chunkSize; begin < order.size(); begin += chunkSize) {
+    futures.push_back(std::async(
+        std::launch::async, work, begin, std::min(begin + chunkSize, order.size())));
+  }
+  work(0, chunkSize);
+  for (auto& future : futures) {
+    future.get();
+  }
+  return result;
+}
+
+BoundingBox Grid::bounding_box() const { return bBox; }
+
+bool Grid::fits(size_t nodeCount) const
+{
+  return std::all_of(
+      positions.begin(), positions.end(), [=](NodePos pos) { return pos < nodeCount; });
+}
 
 double haversine_distance(const Node& a, const Node& b)
 {
-  const double EARTH_RADIUS = 6371007.2;
-  const double RADIANS_CONVERSION = M_PI / 180;
-  using namespace std;
-
-  double theta1 = a.lat() * RADIANS_CONVERSION;
-  double theta2 = b.lat() * RADIANS_CONVERSION;
-  double deltaTheta = (b.lat() - a.lat()) * RADIANS_CONVERSION;
-  double deltaLambda = (b.lng() - a.lng()) * RADIANS_CONVERSION;
-  double e = pow(sin(deltaTheta / 2), 2)
-      + std::cos(theta1) * std::cos(theta2) * pow(sin(deltaLambda / 2), 2);
-  double c = 2 * asin(sqrt(e));
-  return EARTH_RADIUS * c;
+  return haversine_distance(PositionalNode { a.lat(), a.lng(), NodePos { 0 } },
+      PositionalNode { b.lat(), b.lng(), NodePos { 0 } });
 }
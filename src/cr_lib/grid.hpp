@@ -19,9 +19,15 @@
 #define GRID_H
 
 #include "namedType.hpp"
+#include <algorithm>
+#include <array>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
 #include <cstdint>
 #include <limits>
 #include <optional>
+#include <stdexcept>
+#include <vector>
 
 using NodePos = NamedType<uint32_t, struct NodePosParameter>;
 using Lat = NamedType<double, struct LatParameter>;
@@ -29,6 +35,11 @@ using Lng = NamedType<double, struct LngParameter>;
 
 class Node;
 
+struct LatLng {
+  Lat lat;
+  Lng lng;
+};
+
 struct PositionalNode {
   Lat lat;
   Lng lng;
@@ -68,30 +79,161 @@ struct BoundingBox {
   {
     return lat_min <= lat && lat <= lat_max && lng_min <= lng && lng <= lng_max;
   }
+
+  template <class Archive> void serialize(Archive& ar, const unsigned int /*version*/)
+  {
+    ar& lat_min;
+    ar& lat_max;
+    ar& lng_min;
+    ar& lng_max;
+  }
 };
 
+// Tree nodes are stored as plain arrays, which binary archives write in one
+// block instead of element by element.
+template <class TreeNode>
+void flattenTree(const std::vector<TreeNode>& tree, std::vector<double>& bounds,
+    std::vector<uint32_t>& ranges)
+{
+  bounds.reserve(6 * tree.size());
+  ranges.reserve(2 * tree.size());
+  for (const auto& node : tree) {
+    bounds.insert(bounds.end(), node.min.begin(), node.min.end());
+    bounds.insert(bounds.end(), node.max.begin(), node.max.end());
+    ranges.push_back(node.begin);
+    ranges.push_back(node.end);
+  }
+}
+
+// Queries index leaves and items without further checks, so a truncated or
+// stale file has to fail here. itemCount is the number of indexed items.
+template <class TreeNode>
+std::vector<TreeNode> unflattenTree(const std::vector<double>& bounds,
+    const std::vector<uint32_t>& ranges, size_t itemCount, size_t leafLevel)
+{
+  if (bounds.size() != 3 * ranges.size() || leafLevel >= 63
+      || ranges.size() != 2 * ((size_t { 2 } << leafLevel) - 1)) {
+    throw std::runtime_error("Spatial index in graph file is corrupted");
+  }
+  std::vector<TreeNode> tree(ranges.size() / 2);
+  for (size_t i = 0; i < tree.size(); ++i) {
+    std::copy_n(bounds.begin() + 6 * i, 3, tree[i].min.begin());
+    std::copy_n(bounds.begin() + 6 * i + 3, 3, tree[i].max.begin());
+    tree[i].begin = ranges[2 * i];
+    tree[i].end = ranges[2 * i + 1];
+    if (tree[i].begin > tree[i].end || tree[i].end > itemCount) {
+      throw std::runtime_error("Spatial index in graph file is corrupted");
+    }
+  }
+  return tree;
+}
+
+// Spatial index for snapping coordinates to nodes. Nodes are stored as unit
+// vectors on the sphere in a static, balanced k-d tree, so dense cities get
+// as many levels as they need. The nearest node by chord length is also the
+// nearest by great circle distance, which makes queries exact without any
+// trigonometry per candidate.
 class Grid {
   public:
   Grid() = delete;
-  Grid(const std::vector<Node>& nodes, long sideLength = 100);
+  Grid(const std::vector<Node>& nodes);
   Grid(const Grid& other) = default;
   Grid(Grid&& other) noexcept = default;
   virtual ~Grid() noexcept = default;
   Grid& operator=(const Grid& other) = default;
   Grid& operator=(Grid&& other) noexcept = default;
 
-  std::optional<NodePos> findNextNode(Lat lat, Lng lng);
-  BoundingBox bounding_box();
+  size_t size() const { return positions.size(); }
+  // False if a loaded index points to nodes beyond nodeCount.
+  bool fits(size_t nodeCount) const;
+  std::optional<NodePos> findNextNode(Lat lat, Lng lng) const;
+  // Snaps many coordinates at once. Queries are answered in Morton order, so
+  // consecutive ones visit the same part of the tree, and split across
+  // threadCount threads (0 for one per core). Results keep the input order.
+  std::vector<std::optional<NodePos>> findNextNodes(
+      const std::vector<LatLng>& coordinates, size_t threadCount = 0) const;
+  BoundingBox bounding_box() const;
 
   protected:
   private:
-  size_t coordsToIndex(Lat lat, Lng lng);
+  friend class boost::serialization::access;
+
+  static const size_t LEAF_SIZE = 16;
+  // Halving rounds up, so leaves can hold one more point than LEAF_SIZE.
+  static const size_t MAX_LEAF_SIZE = LEAF_SIZE + 1;
+
+  struct Point {
+    std::array<double, 3> coords;
+    NodePos pos;
+  };
+  struct TreeNode {
+    std::array<double, 3> min;
+    std::array<double, 3> max;
+    uint32_t begin;
+    uint32_t end;
+  };
+
+  void build(std::vector<Point>& points, size_t node, size_t level, size_t begin, size_t end,
+      size_t parallelLevels);
+  double boxDistance(const TreeNode& node, const std::array<double, 3>& target) const;
 
   BoundingBox bBox;
-  std::vector<PositionalNode> nodes;
-  std::vector<size_t> offset;
-  long sideLength;
+  // Unit vectors of the nodes in tree order, one array per coordinate.
+  std::array<std::vector<double>, 3> coords;
+  std::vector<NodePos> positions;
+  std::vector<TreeNode> tree;
+  size_t leafLevel;
+
+  template <class Archive> void save(Archive& ar, const unsigned int /*version*/) const
+  {
+    std::vector<uint32_t> rawPositions(positions.begin(), positions.end());
+    std::vector<double> bounds;
+    std::vector<uint32_t> ranges;
+    flattenTree(tree, bounds, ranges);
+    ar& bBox;
+    ar& coords[0];
+    ar& coords[1];
+    ar& coords[2];
+    ar& rawPositions;
+    ar& bounds;
+    ar& ranges;
+    ar& leafLevel;
+  }
+
+  template <class Archive> void load(Archive& ar, const unsigned int /*version*/)
+  {
+    std::vector<uint32_t> rawPositions;
+    std::vector<double> bounds;
+    std::vector<uint32_t> ranges;
+    ar& bBox;
+    ar& coords[0];
+    ar& coords[1];
+    ar& coords[2];
+    ar& rawPositions;
+    ar& bounds;
+    ar& ranges;
+    ar& leafLevel;
+    for (const auto& c : coords) {
+      if (c.size() != rawPositions.size()) {
+        throw std::runtime_error("Spatial index in graph file is corrupted");
+      }
+    }
+    positions.clear();
+    positions.reserve(rawPositions.size());
+    for (auto pos : rawPositions) {
+      positions.push_back(NodePos { pos });
+    }
+    tree = unflattenTree<TreeNode>(bounds, ranges, positions.size(), leafLevel);
+  }
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
 };
 
+// Conversion between coordinates and points on the unit sphere.
+std::array<double, 3> unit_vector(Lat lat, Lng lng);
+LatLng from_unit_vector(const std::array<double, 3>& v);
+// Great circle distance in meters for the squared distance of two unit vectors.
+double chord_to_distance(double squaredChord);
+
 double haversine_distance(const PositionalNode& a, const PositionalNode& b);
+double haversine_distance(const Node& a, const Node& b);
 #endif /* GRID_H */
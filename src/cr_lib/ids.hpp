@@ -1,6 +1,6 @@
 /*
   Cycle-routing does multi-criteria route planning for bicycles.
-  Copyright (C) 2017  Florian Barth
+  Copyright (C) 2019  Florian Barth
 
   This program is free software: you can redistribute it and/or modify
   it under the terms of the GNU General Public License as published by
@@ -15,26 +15,12 @@
   You should have received a copy of the GNU General Public License
   along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
-#include "loginfo.hpp"
+#ifndef IDS_H
+#define IDS_H
 
-#include <algorithm>
+#include "namedType.hpp"
+#include <cstdint>
 
-Logger::Logger() {}
+using EdgeId = NamedType<uint32_t, struct EdgeParameter>;
 
-thread_local Logger Logger::instance;
-std::string info;
-
-Logger* Logger::getInstance() { return &instance; }
-void Logger::init() { info.clear(); }
-
-Logger::~Logger() {}
-
-std::string& Logger::getInfo()
-{
-  info.erase(info.begin(),
-      std::find_if(info.begin(), info.end(), [](int ch) { return !std::isspace(ch); }));
-  info.erase(
-      std::find_if(info.rbegin(), info.rend(), [](int ch) { return !std::isspace(ch); }).base(),
-      info.end());
-  return info;
-}
+#endif /* IDS_H */
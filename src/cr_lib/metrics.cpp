@@ -0,0 +1,189 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "metrics.hpp"
+
+#include <cmath>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+
+size_t Histogram::bucket_index(uint64_t value)
+{
+  if (value < SUB_BUCKETS) {
+    return value;
+  }
+  const size_t msb = 63 - __builtin_clzll(value);
+  const size_t shift = msb - SUB_BUCKET_BITS;
+  const size_t mantissa = (value >> shift) - SUB_BUCKETS;
+  return SUB_BUCKETS + shift * SUB_BUCKETS + mantissa;
+}
+
+uint64_t Histogram::bucket_upper_bound(size_t index)
+{
+  if (index < SUB_BUCKETS) {
+    return index;
+  }
+  const size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+  const uint64_t mantissa = (index - SUB_BUCKETS) % SUB_BUCKETS;
+  return ((SUB_BUCKETS + mantissa + 1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+  buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::quantile(double q) const
+{
+  // Work on a snapshot so concurrent recording cannot move the rank.
+  uint64_t total = 0;
+  std::array<uint64_t, BUCKET_COUNT> snapshot;
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+    total += snapshot[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * total)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    seen += snapshot[i];
+    if (seen >= rank) {
+      return bucket_upper_bound(i);
+    }
+  }
+  return bucket_upper_bound(BUCKET_COUNT - 1);
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(
+    const std::string& name, const std::string& help, Type type, double scale)
+{
+  for (auto& f : families) {
+    if (f.name == name) {
+      if (f.type != type) {
+        throw std::invalid_argument("Metric " + name + " registered with different types");
+      }
+      return f;
+    }
+  }
+  families.push_back(Family { name, help, type, scale, {} });
+  return families.back();
+}
+
+Counter& MetricsRegistry::counter(
+    const std::string& name, const std::string& help, const Labels& labels)
+{
+  auto& f = family(name, help, Type::Counter, 1.0);
+  counters.emplace_back();
+  f.series.push_back(Series { labels, &counters.back(), nullptr, {} });
+  return counters.back();
+}
+
+Histogram& MetricsRegistry::histogram(
+    const std::string& name, const std::string& help, const Labels& labels, double scale)
+{
+  auto& f = family(name, help, Type::Summary, scale);
+  histograms.emplace_back();
+  f.series.push_back(Series { labels, nullptr, &histograms.back(), {} });
+  return histograms.back();
+}
+
+void MetricsRegistry::gauge(const std::string& name, const std::string& help,
+    std::function<double()> value, const Labels& labels)
+{
+  auto& f = family(name, help, Type::Gauge, 1.0);
+  f.series.push_back(Series { labels, nullptr, nullptr, std::move(value) });
+}
+
+namespace {
+std::string formatLabels(const MetricsRegistry::Labels& labels)
+{
+  if (labels.empty()) {
+    return "";
+  }
+  std::string result = "{";
+  for (size_t i = 0; i < labels.size(); ++i) {
+    if (i > 0) {
+      result += ',';
+    }
+    result += labels[i].first + "=\"";
+    for (char c : labels[i].second) {
+      if (c == '\\' || c == '"') {
+        result += '\\';
+        result += c;
+      } else if (c == '\n') {
+        result += "\\n";
+      } else {
+        result += c;
+      }
+    }
+    result += '"';
+  }
+  return result + "}";
+}
+}
+
+std::string MetricsRegistry::render() const
+{
+  const std::array<double, 5> QUANTILES = { 0.5, 0.9, 0.95, 0.99, 0.999 };
+
+  std::ostringstream out;
+  out.imbue(std::locale::classic());
+  out.precision(15);
+  for (const auto& f : families) {
+    out << "# HELP " << f.name << ' ' << f.help << '\n';
+    switch (f.type) {
+    case Type::Counter:
+      out << "# TYPE " << f.name << " counter\n";
+      for (const auto& s : f.series) {
+        out << f.name << formatLabels(s.labels) << ' ' << s.counter->get() << '\n';
+      }
+      break;
+    case Type::Gauge:
+      out << "# TYPE " << f.name << " gauge\n";
+      for (const auto& s : f.series) {
+        out << f.name << formatLabels(s.labels) << ' ' << s.gauge() << '\n';
+      }
+      break;
+    case Type::Summary:
+      out << "# TYPE " << f.name << " summary\n";
+      for (const auto& s : f.series) {
+        for (auto q : QUANTILES) {
+          auto labels = s.labels;
+          std::ostringstream quantile;
+          quantile.imbue(std::locale::classic());
+          quantile << q;
+          labels.emplace_back("quantile", quantile.str());
+          out << f.name << formatLabels(labels) << ' ' << s.histogram->quantile(q) * f.scale
+              << '\n';
+        }
+        out << f.name << "_sum" << formatLabels(s.labels) << ' ' << s.histogram->sum() * f.scale
+            << '\n';
+        out << f.name << "_count" << formatLabels(s.labels) << ' ' << s.histogram->count()
+            << '\n';
+      }
+      break;
+    }
+  }
+  return out.str();
+}
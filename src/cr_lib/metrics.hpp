@@ -0,0 +1,112 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+class Counter {
+  public:
+  void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+  private:
+  std::atomic<uint64_t> value { 0 };
+};
+
+// Log-linear histogram in the style of HdrHistogram: every power of two is
+// split into 32 linear sub-buckets, so recorded values keep a relative
+// precision of about 3% over the whole uint64 range. Recording is lock free.
+class Histogram {
+  public:
+  static constexpr size_t SUB_BUCKET_BITS = 5;
+  static constexpr size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr size_t BUCKET_COUNT = SUB_BUCKETS * (64 - SUB_BUCKET_BITS + 1);
+
+  void record(uint64_t value);
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+  // Upper bound of the bucket containing the given quantile, 0 if empty.
+  uint64_t quantile(double q) const;
+
+  static size_t bucket_index(uint64_t value);
+  static uint64_t bucket_upper_bound(size_t index);
+
+  private:
+  std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets {};
+  std::atomic<uint64_t> count_ { 0 };
+  std::atomic<uint64_t> sum_ { 0 };
+};
+
+// Collection of named metrics rendered in the Prometheus text format.
+// Metrics have to be registered before they are used concurrently, updating
+// and rendering registered metrics is thread safe.
+class MetricsRegistry {
+  public:
+  using Labels = std::vector<std::pair<std::string, std::string>>;
+
+  Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {});
+  // Histograms are reported as summaries with quantiles. Recorded values are
+  // multiplied by scale for reporting, e.g. 1e-6 to record in µs and report in s.
+  Histogram& histogram(const std::string& name, const std::string& help,
+      const Labels& labels = {}, double scale = 1.0);
+  void gauge(const std::string& name, const std::string& help, std::function<double()> value,
+      const Labels& labels = {});
+
+  std::string render() const;
+
+  private:
+  enum class Type { Counter, Gauge, Summary };
+  struct Series {
+    Labels labels;
+    Counter* counter = nullptr;
+    Histogram* histogram = nullptr;
+    std::function<double()> gauge;
+  };
+  struct Family {
+    std::string name;
+    std::string help;
+    Type type;
+    double scale;
+    std::vector<Series> series;
+  };
+
+  Family& family(const std::string& name, const std::string& help, Type type, double scale);
+
+  std::deque<Family> families;
+  std::deque<Counter> counters;
+  std::deque<Histogram> histograms;
+};
+
+template <class TimePoint> uint64_t micros_since(TimePoint start)
+{
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::high_resolution_clock::now() - start);
+  return static_cast<uint64_t>(elapsed.count());
+}
+
+#endif /* METRICS_H */
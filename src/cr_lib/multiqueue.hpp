@@ -22,6 +22,7 @@
 #include <condition_variable>
 #include <deque>
 #include <mutex>
+#include <vector>
 
 template <class T> class MultiQueue {
   public:
@@ -46,6 +47,17 @@ template <class T> class MultiQueue {
     non_empty.notify_one();
   }
 
+  bool try_send(const T& value)
+  {
+    std::lock_guard guard(key);
+    if (closed_ || fifo.size() >= maxSize) {
+      return false;
+    }
+    fifo.push_back(value);
+    non_empty.notify_one();
+    return true;
+  }
+
   void send(std::vector<T>& values)
   {
     size_t valueSize = values.size();
@@ -18,6 +18,8 @@
 #ifndef NDIJKSTRA_H
 #define NDIJKSTRA_H
 #include "dijkstra.hpp"
+#include <functional>
+#include <limits>
 #include <queue>
 #include <unordered_map>
 
@@ -67,13 +69,30 @@ template <int Dim> class NormalDijkstra {
   size_t pqPops = 0;
 
   private:
+  static constexpr uint32_t NO_PREVIOUS = std::numeric_limits<uint32_t>::max();
+
   void clearState();
   RouteWithCountD buildRoute(const NodePos& from, const NodePos& to);
-
+  void reach(NodePos node);
+  double costOf(NodePos node) const;
+  uint32_t firstPrevious(NodePos node) const;
+  void setPrevious(NodePos node, EdgeId edge);
+  void addPrevious(NodePos node, EdgeId edge);
+
+  // Per node state is only valid if the node was reached in the current
+  // epoch, so a new query does not have to reset the nodes of the last one.
+  uint32_t epoch = 0;
+  std::vector<uint32_t> reachedIn;
   std::vector<double> cost;
   std::vector<NodePos> touched;
   std::vector<size_t> paths;
-  std::vector<std::vector<HalfEdgeD>> previousEdge;
+
+  // Predecessor edges of all nodes share one buffer. previousHead holds the
+  // first entry of a node, the entry found first, previousNext links the
+  // entries of the same node.
+  std::vector<uint32_t> previousHead;
+  std::vector<EdgeId> previousEdges;
+  std::vector<uint32_t> previousNext;
 
   NodePos from, to;
 
@@ -87,32 +106,11 @@ template <int Dim> class NormalDijkstra {
   bool unpack;
 };
 
-template <int Dim> using RouteQueueElem = std::tuple<RouteWithCount<Dim>, NodePos>;
-template <int Dim> struct BiggerRouteCost {
-  using ConfigD = Config<Dim>;
-  using RouteQueueElemD = RouteQueueElem<Dim>;
-  using RouteWithCountD = RouteWithCount<Dim>;
-
-  BiggerRouteCost(ConfigD usedConfig)
-      : usedConfig(usedConfig)
-  {
-  }
-  bool operator()(RouteQueueElemD left, RouteQueueElemD right)
-  {
-    auto leftRoute = std::get<RouteWithCountD>(left);
-    auto rightRoute = std::get<RouteWithCountD>(right);
-    return leftRoute.costs * usedConfig > rightRoute.costs * usedConfig;
-  }
-
-  ConfigD usedConfig;
-};
-
 template <int Dim> class RouteIterator {
   public:
   using NormalDijkstraD = NormalDijkstra<Dim>;
   using RouteWithCountD = RouteWithCount<Dim>;
-  using RouteQueueElemD = RouteQueueElem<Dim>;
-  using BiggerRouteCostD = BiggerRouteCost<Dim>;
+  using CostD = Cost<Dim>;
 
   RouteIterator(NormalDijkstraD* dijkstra, NodePos from, NodePos to, size_t maxHeapSize = 500);
   ~RouteIterator() = default;
@@ -122,13 +120,36 @@ template <int Dim> class RouteIterator {
   void doubleHeapsize();
 
   private:
+  static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+
+  // Partial routes end at the target and share their common end: each one
+  // extends its parent by an edge at the front.
+  struct PartialRoute {
+    CostD costs;
+    NodePos start;
+    EdgeId edge;
+    uint32_t parent;
+  };
+
+  bool visits(uint32_t route, NodePos node) const;
+  RouteWithCountD buildRoute(uint32_t route) const;
+
   NormalDijkstraD* dijkstra;
   size_t maxHeapSize;
   NodePos from;
   NodePos to;
   size_t outputCount = 0;
+
+  std::vector<PartialRoute> routes;
+  // Every route has a bitset of the nodes it passes, visitedWords words
+  // long. Bits are only given to the nodes with predecessors to the target.
+  std::unordered_map<uint32_t, uint32_t> nodeBits;
+  size_t visitedWords;
+  std::vector<uint64_t> visited;
+
+  using QueueElem = std::pair<double, uint32_t>;
   using RouteQueue
-      = std::priority_queue<RouteQueueElemD, std::vector<RouteQueueElemD>, BiggerRouteCostD>;
+      = std::priority_queue<QueueElem, std::vector<QueueElem>, std::greater<QueueElem>>;
   RouteQueue heap;
 };
 
@@ -0,0 +1,184 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef PARETO_FRONT_H
+#define PARETO_FRONT_H
+
+#include "graph.hpp"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// True if c1 is at most as expensive as c2 in every metric.
+template <int Dim> bool dominates(const Cost<Dim>& c1, const Cost<Dim>& c2)
+{
+  for (size_t i = 0; i < Dim; ++i) {
+    if (c1.values[i] > c2.values[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Costs which do not dominate each other, each with a value attached.
+//
+// Every metric is stored in its own array, sorted by the first metric. Only
+// members with a smaller first cost can dominate a candidate and only those
+// with a larger one can be dominated by it, the other metrics are compared
+// four members at a time when built with AVX2. Of equal costs only the first
+// inserted is kept.
+template <int Dim, class Value = size_t> class ParetoFront {
+  public:
+  using CostD = Cost<Dim>;
+
+  size_t size() const { return values.size(); }
+  bool empty() const { return values.empty(); }
+  void clear()
+  {
+    for (auto& metric : costs) {
+      metric.clear();
+    }
+    values.clear();
+  }
+
+  const std::vector<Value>& getValues() const { return values; }
+  CostD getCost(size_t i) const
+  {
+    CostD c;
+    for (size_t metric = 0; metric < Dim; ++metric) {
+      c.values[metric] = costs[metric][i];
+    }
+    return c;
+  }
+
+  // True if some member dominates c.
+  bool dominates(const CostD& c) const
+  {
+    const size_t end
+        = std::upper_bound(costs[0].begin(), costs[0].end(), c.values[0]) - costs[0].begin();
+    size_t i = 0;
+#ifdef __AVX2__
+    for (; i + 4 <= end; i += 4) {
+      if (compareBlock<true>(i, c) != 0) {
+        return true;
+      }
+    }
+#endif
+    for (; i < end; ++i) {
+      if (compare<true>(i, c)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Adds c unless it is dominated. Members dominated by c are passed to
+  // removed and dropped.
+  template <class Removed> bool insert(const CostD& c, Value value, Removed removed)
+  {
+    if (dominates(c)) {
+      return false;
+    }
+
+    const size_t start
+        = std::lower_bound(costs[0].begin(), costs[0].end(), c.values[0]) - costs[0].begin();
+    size_t kept = start;
+    auto keep = [&](size_t i, bool dominated) {
+      if (dominated) {
+        removed(values[i]);
+        return;
+      }
+      if (kept != i) {
+        for (auto& metric : costs) {
+          metric[kept] = metric[i];
+        }
+        values[kept] = std::move(values[i]);
+      }
+      ++kept;
+    };
+    size_t i = start;
+#ifdef __AVX2__
+    for (; i + 4 <= size(); i += 4) {
+      const int mask = compareBlock<false>(i, c);
+      for (size_t j = 0; j < 4; ++j) {
+        keep(i + j, (mask >> j) & 1);
+      }
+    }
+#endif
+    for (; i < size(); ++i) {
+      keep(i, compare<false>(i, c));
+    }
+    for (auto& metric : costs) {
+      metric.resize(kept);
+    }
+    values.erase(values.begin() + kept, values.end());
+
+    const size_t pos
+        = std::upper_bound(costs[0].begin(), costs[0].end(), c.values[0]) - costs[0].begin();
+    for (size_t metric = 0; metric < Dim; ++metric) {
+      costs[metric].insert(costs[metric].begin() + pos, c.values[metric]);
+    }
+    values.insert(values.begin() + pos, std::move(value));
+    return true;
+  }
+
+  bool insert(const CostD& c, Value value)
+  {
+    return insert(c, std::move(value), [](const Value&) {});
+  }
+
+  private:
+  // Compares member i and c in all metrics but the first, which the callers
+  // already know about. With memberFirst the member has to be at most as
+  // expensive as c, otherwise c at most as expensive as the member.
+  template <bool memberFirst> bool compare(size_t i, const CostD& c) const
+  {
+    for (size_t metric = 1; metric < Dim; ++metric) {
+      const double member = costs[metric][i];
+      if (memberFirst ? member > c.values[metric] : c.values[metric] > member) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+#ifdef __AVX2__
+  // compare for members i to i + 3, one bit per member.
+  template <bool memberFirst> int compareBlock(size_t i, const CostD& c) const
+  {
+    __m256d result = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    for (size_t metric = 1; metric < Dim; ++metric) {
+      const __m256d member = _mm256_loadu_pd(costs[metric].data() + i);
+      const __m256d candidate = _mm256_set1_pd(c.values[metric]);
+      const __m256d lessEqual = memberFirst ? _mm256_cmp_pd(member, candidate, _CMP_LE_OQ)
+                                            : _mm256_cmp_pd(candidate, member, _CMP_LE_OQ);
+      result = _mm256_and_pd(result, lessEqual);
+    }
+    return _mm256_movemask_pd(result);
+  }
+#endif
+
+  std::array<std::vector<double>, Dim> costs;
+  std::vector<Value> values;
+};
+
+#endif /* PARETO_FRONT_H */
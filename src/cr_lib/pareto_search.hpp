@@ -0,0 +1,86 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef PARETO_SEARCH_H
+#define PARETO_SEARCH_H
+
+#include "dijkstra.hpp"
+#include "pareto_front.hpp"
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+// Multicriteria label-setting search for the complete Pareto set between two
+// nodes. Every node keeps a bag of labels which do not dominate each other.
+// Labels leave the queue in lexicographic order of their costs, so a popped
+// label is final unless a label dominating it was found in the meantime.
+// Labels dominated by one already at the target are dropped right away.
+//
+// Only original edges are used. Of routes with equal costs only one is
+// reported.
+template <int Dim> class ParetoSearch {
+  public:
+  using GraphD = Graph<Dim>;
+  using CostD = Cost<Dim>;
+  using EdgeD = Edge<Dim>;
+  using RouteD = Route<Dim>;
+  using FrontD = ParetoFront<Dim, uint32_t>;
+
+  ParetoSearch(const GraphD* g);
+
+  // Returns the routes ordered lexicographically by their costs.
+  std::vector<RouteD> run(NodePos from, NodePos to);
+
+  // Labels created and popped during the last run.
+  size_t labelCount = 0;
+  size_t pqPops = 0;
+
+  private:
+  static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+  static constexpr uint32_t NO_BAG = std::numeric_limits<uint32_t>::max();
+
+  struct Label {
+    CostD costs;
+    NodePos node;
+    EdgeId edge;
+    uint32_t parent;
+    bool dominated;
+  };
+  using QueueElem = std::pair<std::array<double, Dim>, uint32_t>;
+  using Queue = std::priority_queue<QueueElem, std::vector<QueueElem>, std::greater<QueueElem>>;
+
+  bool isDominated(NodePos node, const CostD& costs) const;
+  void addLabel(NodePos node, const CostD& costs, EdgeId edge, uint32_t parent);
+  RouteD buildRoute(uint32_t label) const;
+  void clearState();
+
+  const GraphD* graph;
+  NodePos to;
+  std::vector<Label> labels;
+  // Bags are only kept for reached nodes and reused by later runs.
+  std::vector<uint32_t> bagOf;
+  std::vector<FrontD> bags;
+  size_t usedBags = 0;
+  std::vector<NodePos> touched;
+  Queue heap;
+};
+
+#include "pareto_search.inc"
+#endif /* PARETO_SEARCH_H */
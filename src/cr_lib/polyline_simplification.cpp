@@ -0,0 +1,196 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "polyline_simplification.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+const double EARTH_RADIUS = 6371007.2;
+const double RADIANS_CONVERSION = M_PI / 180;
+
+struct Point {
+  double x;
+  double y;
+};
+
+// Local equirectangular projection around the first point. Precise enough for
+// the extent of a single route and avoids trigonometry per point.
+std::vector<Point> project(const std::vector<LatLng>& points)
+{
+  std::vector<Point> projected;
+  projected.reserve(points.size());
+
+  const double lat0 = points.front().lat;
+  const double lng0 = points.front().lng;
+  const double scale_y = EARTH_RADIUS * RADIANS_CONVERSION;
+  const double scale_x = scale_y * std::cos(lat0 * RADIANS_CONVERSION);
+  for (const auto& p : points) {
+    projected.push_back(Point { (p.lng - lng0) * scale_x, (p.lat - lat0) * scale_y });
+  }
+  return projected;
+}
+
+double normalize_angle(double angle)
+{
+  while (angle > M_PI) {
+    angle -= 2 * M_PI;
+  }
+  while (angle <= -M_PI) {
+    angle += 2 * M_PI;
+  }
+  return angle;
+}
+}
+
+std::vector<size_t> simplify_polyline(const std::vector<LatLng>& points, double tolerance)
+{
+  std::vector<size_t> kept;
+  if (points.size() <= 2 || tolerance <= 0) {
+    kept.reserve(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      kept.push_back(i);
+    }
+    return kept;
+  }
+
+  const auto projected = project(points);
+
+  kept.push_back(0);
+  size_t anchor = 0;
+  size_t last = 0;
+
+  // The sector of directions from the anchor whose rays pass within tolerance
+  // of all points since the anchor. Stored relative to the sector center to
+  // avoid wrap-around at +-pi.
+  bool sector_open = false;
+  double center = 0;
+  double lower = 0;
+  double upper = 0;
+  double max_dist = 0;
+
+  for (size_t i = anchor + 1; i < projected.size(); ++i) {
+    const double dx = projected[i].x - projected[anchor].x;
+    const double dy = projected[i].y - projected[anchor].y;
+    const double dist = std::hypot(dx, dy);
+
+    // A segment ending closer to the anchor than an earlier point would leave
+    // that point behind its end and possibly too far away from it.
+    bool fits = dist >= max_dist || !sector_open;
+    if (fits && dist > tolerance) {
+      const double half_width = std::asin(tolerance / dist);
+      const double angle = std::atan2(dy, dx);
+      if (!sector_open) {
+        sector_open = true;
+        center = angle;
+        lower = -half_width;
+        upper = half_width;
+      } else {
+        const double relative = normalize_angle(angle - center);
+        fits = lower <= relative && relative <= upper;
+        if (fits) {
+          lower = std::max(lower, relative - half_width);
+          upper = std::min(upper, relative + half_width);
+        }
+      }
+    }
+
+    if (fits) {
+      max_dist = std::max(max_dist, dist);
+      last = i;
+      continue;
+    }
+
+    kept.push_back(last);
+    anchor = last;
+    sector_open = false;
+    max_dist = 0;
+    // Each point is revisited at most once with the new anchor, which keeps the
+    // whole simplification linear.
+    i = anchor;
+  }
+
+  if (kept.back() != projected.size() - 1) {
+    kept.push_back(projected.size() - 1);
+  }
+  return kept;
+}
+
+std::vector<size_t> simplify_profile(
+    const std::vector<double>& distances, const std::vector<double>& heights, double tolerance)
+{
+  std::vector<size_t> kept;
+  if (heights.size() <= 2 || tolerance <= 0) {
+    kept.reserve(heights.size());
+    for (size_t i = 0; i < heights.size(); ++i) {
+      kept.push_back(i);
+    }
+    return kept;
+  }
+
+  kept.push_back(0);
+  size_t anchor = 0;
+  size_t last = 0;
+
+  // Slopes from the anchor which pass within tolerance of all samples since
+  // the anchor, the one dimensional version of the sector above.
+  double lower = std::numeric_limits<double>::lowest();
+  double upper = std::numeric_limits<double>::max();
+
+  for (size_t i = anchor + 1; i < heights.size(); ++i) {
+    const double dx = distances[i] - distances[anchor];
+    const double dy = heights[i] - heights[anchor];
+
+    bool fits;
+    if (dx <= 0) {
+      fits = std::abs(dy) <= tolerance;
+    } else {
+      const double slope = dy / dx;
+      fits = lower <= slope && slope <= upper;
+      if (fits) {
+        lower = std::max(lower, (dy - tolerance) / dx);
+        upper = std::min(upper, (dy + tolerance) / dx);
+      }
+    }
+
+    if (fits) {
+      last = i;
+      continue;
+    }
+
+    // A jump at the distance of the anchor has to become the next anchor.
+    anchor = last == anchor ? i : last;
+    kept.push_back(anchor);
+    last = anchor;
+    lower = std::numeric_limits<double>::lowest();
+    upper = std::numeric_limits<double>::max();
+    i = anchor;
+  }
+
+  if (kept.back() != heights.size() - 1) {
+    kept.push_back(heights.size() - 1);
+  }
+  return kept;
+}
+
+double zoom_to_tolerance(double zoom, Lat lat)
+{
+  const double EQUATOR_METERS_PER_PIXEL = 156543.03392;
+  return EQUATOR_METERS_PER_PIXEL * std::cos(lat * RADIANS_CONVERSION) / std::pow(2.0, zoom);
+}
@@ -0,0 +1,41 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef POLYLINE_SIMPLIFICATION_H
+#define POLYLINE_SIMPLIFICATION_H
+
+#include "grid.hpp"
+
+#include <vector>
+
+// Returns the indices of the points to keep so that every dropped point lies
+// within tolerance (in meters) of the simplified line. First and last point are
+// always kept. Runs in linear time by fitting a directional sector around each
+// anchor (Zhao-Saalfeld sleeve fitting) instead of recursive splitting.
+std::vector<size_t> simplify_polyline(const std::vector<LatLng>& points, double tolerance);
+
+// Same for a height profile given as (distance, height) samples with
+// non-decreasing distances. Every dropped height lies within tolerance (in
+// meters) of the linear interpolation between the kept samples around it.
+std::vector<size_t> simplify_profile(
+    const std::vector<double>& distances, const std::vector<double>& heights, double tolerance);
+
+// Size of one map pixel in meters at the given web mercator zoom level.
+double zoom_to_tolerance(double zoom, Lat lat);
+
+#endif /* POLYLINE_SIMPLIFICATION_H */
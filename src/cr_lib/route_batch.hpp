@@ -0,0 +1,124 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ROUTE_BATCH_H
+#define ROUTE_BATCH_H
+
+#include "dijkstra.hpp"
+#include "grid.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Endpoints are either given as node positions or as coordinates which are
+// snapped to the closest node.
+template <int Dim> struct BatchQuery {
+  std::optional<NodePos> s;
+  std::optional<NodePos> t;
+  std::optional<LatLng> sCoord;
+  std::optional<LatLng> tCoord;
+  Config<Dim> config;
+};
+
+template <int Dim> struct BatchResult {
+  std::optional<Route<Dim>> route;
+  std::string error;
+};
+
+// Shared state of one batch. Any number of workers can call work(), each one
+// claims the next open query until all are taken. Results stay in query order.
+template <int Dim> class RouteBatch {
+  public:
+  RouteBatch(std::vector<BatchQuery<Dim>> queries)
+      : queries(std::move(queries))
+      , results(this->queries.size())
+  {
+  }
+  RouteBatch(const RouteBatch& other) = delete;
+  RouteBatch& operator=(const RouteBatch& other) = delete;
+
+  // Returns true for exactly one caller, the one which finished the last query.
+  // onQuery is called after every Dijkstra query, e.g. to collect its counters.
+  bool work(Dijkstra<Dim>& dijkstra, const Grid& grid,
+      const std::function<void(const Dijkstra<Dim>&)>& onQuery = {})
+  {
+    bool finishedLast = false;
+    for (size_t i = next++; i < queries.size(); i = next++) {
+      results[i] = compute(queries[i], dijkstra, grid, onQuery);
+      if (++done == queries.size()) {
+        finishedLast = true;
+      }
+    }
+    return finishedLast;
+  }
+
+  size_t size() const { return queries.size(); }
+  const std::vector<BatchResult<Dim>>& get_results() const { return results; }
+
+  private:
+  BatchResult<Dim> compute(const BatchQuery<Dim>& query, Dijkstra<Dim>& dijkstra, const Grid& grid,
+      const std::function<void(const Dijkstra<Dim>&)>& onQuery)
+  {
+    auto snap = [&grid](const std::optional<NodePos>& pos, const std::optional<LatLng>& coord) {
+      if (pos) {
+        return pos;
+      }
+      return grid.findNextNode(coord->lat, coord->lng);
+    };
+
+    BatchResult<Dim> result;
+    try {
+      auto s = snap(query.s, query.sCoord);
+      auto t = snap(query.t, query.tCoord);
+      if (!s || !t) {
+        result.error = "No node close to the given coordinates";
+        return result;
+      }
+      result.route = dijkstra.findBestRoute(*s, *t, query.config);
+      if (onQuery) {
+        onQuery(dijkstra);
+      }
+      if (!result.route) {
+        result.error = "Did not find route";
+      }
+    } catch (std::exception& e) {
+      result.error = e.what();
+    }
+    return result;
+  }
+
+  std::vector<BatchQuery<Dim>> queries;
+  std::vector<BatchResult<Dim>> results;
+  std::atomic<size_t> next { 0 };
+  std::atomic<size_t> done { 0 };
+};
+
+// Number of workers one batch may work on. All batches admitted at the same
+// time together leave at least one worker for single queries.
+inline size_t batch_helpers(size_t batchSize, size_t workers, size_t maxBatchJobs)
+{
+  const size_t shared = workers > 1 ? workers - 1 : workers;
+  const size_t share = std::max<size_t>(1, shared / std::max<size_t>(1, maxBatchJobs));
+  return std::min(batchSize, share);
+}
+
+#endif /* ROUTE_BATCH_H */
@@ -0,0 +1,229 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "segment_index.hpp"
+#include "graph.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <thread>
+
+SegmentIndex::SegmentIndex(const std::vector<Node>& nodes, std::vector<Segment> segments)
+{
+  std::vector<Entry> entries;
+  entries.reserve(segments.size());
+  for (const auto& segment : segments) {
+    const auto& source = nodes.at(segment.source);
+    const auto& target = nodes.at(segment.target);
+    entries.push_back(Entry { segment, unit_vector(source.lat(), source.lng()),
+        unit_vector(target.lat(), target.lng()) });
+  }
+
+  leafLevel = 0;
+  while ((entries.size() >> leafLevel) > LEAF_SIZE) {
+    ++leafLevel;
+  }
+  tree.resize((size_t { 2 } << leafLevel) - 1);
+
+  size_t parallelLevels = 0;
+  while ((size_t { 1 } << parallelLevels) < std::thread::hardware_concurrency()) {
+    ++parallelLevels;
+  }
+  build(entries, 0, 0, 0, entries.size(), parallelLevels);
+
+  this->segments.reserve(entries.size());
+  for (size_t d = 0; d < 3; ++d) {
+    starts[d].reserve(entries.size());
+    directions[d].reserve(entries.size());
+  }
+  inverseLengths.reserve(entries.size());
+  for (const auto& entry : entries) {
+    this->segments.push_back(entry.segment);
+    double length = 0;
+    for (size_t d = 0; d < 3; ++d) {
+      starts[d].push_back(entry.a[d]);
+      directions[d].push_back(entry.b[d] - entry.a[d]);
+      length += directions[d].back() * directions[d].back();
+    }
+    // Degenerated segments are treated as their start point.
+    inverseLengths.push_back(length > 0 ? 1 / length : 0);
+  }
+}
+
+void SegmentIndex::build(std::vector<Entry>& entries, size_t node, size_t level, size_t begin,
+    size_t end, size_t parallelLevels)
+{
+  auto& treeNode = tree[node];
+  treeNode.begin = begin;
+  treeNode.end = end;
+  treeNode.min.fill(std::numeric_limits<double>::max());
+  treeNode.max.fill(std::numeric_limits<double>::lowest());
+  for (size_t i = begin; i < end; ++i) {
+    for (size_t d = 0; d < 3; ++d) {
+      treeNode.min[d] = std::min({ treeNode.min[d], entries[i].a[d], entries[i].b[d] });
+      treeNode.max[d] = std::max({ treeNode.max[d], entries[i].a[d], entries[i].b[d] });
+    }
+  }
+  if (level == leafLevel) {
+    return;
+  }
+
+  size_t splitDim = 0;
+  for (size_t d = 1; d < 3; ++d) {
+    if (treeNode.max[d] - treeNode.min[d] > treeNode.max[splitDim] - treeNode.min[splitDim]) {
+      splitDim = d;
+    }
+  }
+  // Segments are split by their midpoints, the boxes of both halves may overlap.
+  const size_t mid = begin + (end - begin) / 2;
+  std::nth_element(entries.begin() + begin, entries.begin() + mid, entries.begin() + end,
+      [splitDim](const Entry& x, const Entry& y) {
+        return x.a[splitDim] + x.b[splitDim] < y.a[splitDim] + y.b[splitDim];
+      });
+
+  if (level < parallelLevels) {
+    auto left = std::async(std::launch::async,
+        [this, &entries, node, level, begin, mid, parallelLevels]() {
+          build(entries, 2 * node + 1, level + 1, begin, mid, parallelLevels);
+        });
+    build(entries, 2 * node + 2, level + 1, mid, end, parallelLevels);
+    left.get();
+  } else {
+    build(entries, 2 * node + 1, level + 1, begin, mid, parallelLevels);
+    build(entries, 2 * node + 2, level + 1, mid, end, parallelLevels);
+  }
+}
+
+double SegmentIndex::boxDistance(const TreeNode& node, const Vector& target) const
+{
+  double dist = 0;
+  for (size_t d = 0; d < 3; ++d) {
+    double delta = 0;
+    if (target[d] < node.min[d]) {
+      delta = node.min[d] - target[d];
+    } else if (target[d] > node.max[d]) {
+      delta = target[d] - node.max[d];
+    }
+    dist += delta * delta;
+  }
+  return dist;
+}
+
+std::optional<SnappedPoint> SegmentIndex::findNextSegment(Lat lat, Lng lng) const
+{
+  if (segments.empty()) {
+    return {};
+  }
+  const auto target = unit_vector(lat, lng);
+
+  struct Candidate {
+    size_t node;
+    size_t level;
+    double dist;
+  };
+  std::array<Candidate, 2 * 64> stack;
+  size_t stackSize = 0;
+  stack[stackSize++] = Candidate { 0, 0, boxDistance(tree[0], target) };
+
+  double bestDist = std::numeric_limits<double>::max();
+  size_t best = 0;
+  double bestFraction = 0;
+  while (stackSize > 0) {
+    const auto candidate = stack[--stackSize];
+    if (candidate.dist >= bestDist) {
+      continue;
+    }
+
+    const auto& treeNode = tree[candidate.node];
+    if (candidate.level == leafLevel) {
+      const size_t begin = treeNode.begin;
+      const size_t count = treeNode.end - begin;
+      const double* ax = starts[0].data() + begin;
+      const double* ay = starts[1].data() + begin;
+      const double* az = starts[2].data() + begin;
+      const double* dx = directions[0].data() + begin;
+      const double* dy = directions[1].data() + begin;
+      const double* dz = directions[2].data() + begin;
+      const double* inverseLength = inverseLengths.data() + begin;
+      // Clamping in its own pass keeps both loops free of branches.
+      std::array<double, MAX_LEAF_SIZE> fractions;
+      for (size_t i = 0; i < count; ++i) {
+        const double tx = target[0] - ax[i];
+        const double ty = target[1] - ay[i];
+        const double tz = target[2] - az[i];
+        fractions[i] = (tx * dx[i] + ty * dy[i] + tz * dz[i]) * inverseLength[i];
+      }
+      for (size_t i = 0; i < count; ++i) {
+        fractions[i] = std::clamp(fractions[i], 0.0, 1.0);
+      }
+      std::array<double, MAX_LEAF_SIZE> dists;
+      for (size_t i = 0; i < count; ++i) {
+        const double ex = target[0] - ax[i] - fractions[i] * dx[i];
+        const double ey = target[1] - ay[i] - fractions[i] * dy[i];
+        const double ez = target[2] - az[i] - fractions[i] * dz[i];
+        dists[i] = ex * ex + ey * ey + ez * ez;
+      }
+      for (size_t i = 0; i < count; ++i) {
+        if (dists[i] < bestDist) {
+          bestDist = dists[i];
+          best = begin + i;
+          bestFraction = fractions[i];
+        }
+      }
+      continue;
+    }
+
+    const size_t left = 2 * candidate.node + 1;
+    const size_t right = left + 1;
+    const Candidate leftCandidate { left, candidate.level + 1, boxDistance(tree[left], target) };
+    const Candidate rightCandidate { right, candidate.level + 1,
+      boxDistance(tree[right], target) };
+    if (leftCandidate.dist < rightCandidate.dist) {
+      stack[stackSize++] = rightCandidate;
+      stack[stackSize++] = leftCandidate;
+    } else {
+      stack[stackSize++] = leftCandidate;
+      stack[stackSize++] = rightCandidate;
+    }
+  }
+
+  // Only the winner is converted back to coordinates and meters.
+  Vector projected;
+  for (size_t d = 0; d < 3; ++d) {
+    projected[d] = starts[d][best] + bestFraction * directions[d][best];
+  }
+  const auto& segment = segments[best];
+  return SnappedPoint { segment.edge, segment.source, segment.target, bestFraction,
+    from_unit_vector(projected), chord_to_distance(bestDist) };
+}
+
+void SegmentIndex::moveEdgeIds(EdgeId oldFirst, EdgeId newFirst)
+{
+  for (auto& segment : segments) {
+    segment.edge = EdgeId { segment.edge - oldFirst + newFirst };
+  }
+}
+
+bool SegmentIndex::fits(size_t nodeCount, size_t edgeCount) const
+{
+  return std::all_of(segments.begin(), segments.end(), [=](const Segment& segment) {
+    return segment.source < nodeCount && segment.target < nodeCount && segment.edge < edgeCount;
+  });
+}
@@ -0,0 +1,157 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SEGMENT_INDEX_H
+#define SEGMENT_INDEX_H
+
+#include "grid.hpp"
+#include "ids.hpp"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct Segment {
+  EdgeId edge;
+  NodePos source;
+  NodePos target;
+};
+
+// Result of snapping a coordinate onto the closest segment. fraction is the
+// position of the projected point between source (0) and target (1).
+struct SnappedPoint {
+  EdgeId edge;
+  NodePos source;
+  NodePos target;
+  double fraction;
+  LatLng point;
+  double distance;
+};
+
+// Spatial index over straight road segments, built like the node index in
+// Grid: a static bounding volume hierarchy over unit vectors whose leaves hold
+// up to 16 segments. Distances are measured to the chord between the two end
+// points, which is indistinguishable from the great circle for road segments.
+class SegmentIndex {
+  public:
+  SegmentIndex() = delete;
+  SegmentIndex(const std::vector<Node>& nodes, std::vector<Segment> segments);
+  SegmentIndex(const SegmentIndex& other) = default;
+  SegmentIndex(SegmentIndex&& other) noexcept = default;
+  virtual ~SegmentIndex() noexcept = default;
+  SegmentIndex& operator=(const SegmentIndex& other) = default;
+  SegmentIndex& operator=(SegmentIndex&& other) noexcept = default;
+
+  std::optional<SnappedPoint> findNextSegment(Lat lat, Lng lng) const;
+  size_t size() const { return segments.size(); }
+  // False if a loaded index points to nodes or edges beyond the given counts.
+  bool fits(size_t nodeCount, size_t edgeCount) const;
+  // Graph files may number their edges from another id than 0, loaded graphs
+  // always start at 0.
+  void moveEdgeIds(EdgeId oldFirst, EdgeId newFirst);
+
+  protected:
+  private:
+  friend class boost::serialization::access;
+
+  static const size_t LEAF_SIZE = 16;
+  static const size_t MAX_LEAF_SIZE = LEAF_SIZE + 1;
+  using Vector = std::array<double, 3>;
+
+  struct Entry {
+    Segment segment;
+    Vector a;
+    Vector b;
+  };
+  struct TreeNode {
+    Vector min;
+    Vector max;
+    uint32_t begin;
+    uint32_t end;
+  };
+
+  void build(std::vector<Entry>& entries, size_t node, size_t level, size_t begin, size_t end,
+      size_t parallelLevels);
+  double boxDistance(const TreeNode& node, const Vector& target) const;
+
+  // Segments in tree order. Leaves are scanned coordinate by coordinate: start
+  // points, directions to the end points and their inverse squared lengths.
+  std::vector<Segment> segments;
+  std::array<std::vector<double>, 3> starts;
+  std::array<std::vector<double>, 3> directions;
+  std::vector<double> inverseLengths;
+  std::vector<TreeNode> tree;
+  size_t leafLevel;
+
+  template <class Archive> void save(Archive& ar, const unsigned int /*version*/) const
+  {
+    std::vector<uint32_t> rawSegments;
+    rawSegments.reserve(3 * segments.size());
+    for (const auto& segment : segments) {
+      rawSegments.push_back(segment.edge);
+      rawSegments.push_back(segment.source);
+      rawSegments.push_back(segment.target);
+    }
+    std::vector<double> bounds;
+    std::vector<uint32_t> ranges;
+    flattenTree(tree, bounds, ranges);
+    ar& rawSegments;
+    for (size_t d = 0; d < 3; ++d) {
+      ar& starts[d];
+      ar& directions[d];
+    }
+    ar& inverseLengths;
+    ar& bounds;
+    ar& ranges;
+    ar& leafLevel;
+  }
+
+  template <class Archive> void load(Archive& ar, const unsigned int /*version*/)
+  {
+    std::vector<uint32_t> rawSegments;
+    std::vector<double> bounds;
+    std::vector<uint32_t> ranges;
+    ar& rawSegments;
+    for (size_t d = 0; d < 3; ++d) {
+      ar& starts[d];
+      ar& directions[d];
+    }
+    ar& inverseLengths;
+    ar& bounds;
+    ar& ranges;
+    ar& leafLevel;
+    const size_t count = rawSegments.size() / 3;
+    bool complete = rawSegments.size() == 3 * count && inverseLengths.size() == count;
+    for (size_t d = 0; d < 3; ++d) {
+      complete = complete && starts[d].size() == count && directions[d].size() == count;
+    }
+    if (!complete) {
+      throw std::runtime_error("Spatial index in graph file is corrupted");
+    }
+    segments.clear();
+    segments.reserve(count);
+    for (size_t i = 0; i + 2 < rawSegments.size(); i += 3) {
+      segments.push_back(Segment { EdgeId { rawSegments[i] }, NodePos { rawSegments[i + 1] },
+          NodePos { rawSegments[i + 2] } });
+    }
+    tree = unflattenTree<TreeNode>(bounds, ranges, segments.size(), leafLevel);
+  }
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+};
+
+#endif /* SEGMENT_INDEX_H */
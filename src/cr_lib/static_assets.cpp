@@ -0,0 +1,204 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "static_assets.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+
+namespace fs = boost::filesystem;
+namespace iostr = boost::iostreams;
+
+namespace {
+std::string trimSlashes(const std::string& path)
+{
+  auto begin = path.find_first_not_of('/');
+  if (begin == std::string::npos) {
+    return "";
+  }
+  auto end = path.find_last_not_of('/');
+  return path.substr(begin, end - begin + 1);
+}
+
+std::string readFile(const fs::path& path)
+{
+  std::ifstream ifs { path.string(), std::ios::in | std::ios::binary };
+  std::ostringstream content;
+  content << ifs.rdbuf();
+  return content.str();
+}
+
+std::string gzip(const std::string& content)
+{
+  std::string compressed;
+  {
+    iostr::filtering_ostream out;
+    out.push(iostr::gzip_compressor(iostr::gzip_params(iostr::gzip::best_compression)));
+    out.push(iostr::back_inserter(compressed));
+    out.write(content.data(), content.size());
+  }
+  return compressed;
+}
+
+// FNV-1a, only used to detect changed content between server starts
+std::string etagOf(const std::string& content, const std::string& suffix = "")
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : content) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  std::ostringstream etag;
+  etag << '"' << std::hex << hash << '-' << content.size() << suffix << '"';
+  return etag.str();
+}
+
+std::string contentTypeOf(const fs::path& path)
+{
+  static const std::unordered_map<std::string, std::string> types {
+    { ".html", "text/html; charset=utf-8" },
+    { ".js", "application/javascript" },
+    { ".css", "text/css" },
+    { ".map", "application/json" },
+    { ".json", "application/json" },
+    { ".png", "image/png" },
+    { ".svg", "image/svg+xml" },
+  };
+  auto type = types.find(path.extension().string());
+  if (type == types.end()) {
+    return "application/octet-stream";
+  }
+  return type->second;
+}
+
+std::string trimSpaces(const std::string& value)
+{
+  auto begin = value.find_first_not_of(" \t");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  auto end = value.find_last_not_of(" \t");
+  return value.substr(begin, end - begin + 1);
+}
+}
+
+StaticAssets::StaticAssets(const std::string& webRoot)
+{
+  if (!fs::is_directory(webRoot)) {
+    std::cerr << "web root " << webRoot << " is not a directory, no files will be served" << '\n';
+    return;
+  }
+  auto root = fs::canonical(webRoot);
+
+  for (const auto& entry : fs::recursive_directory_iterator(root)) {
+    if (!fs::is_regular_file(entry.status())) {
+      continue;
+    }
+    const auto& path = entry.path();
+    auto relative = trimSlashes(path.generic_string().substr(root.generic_string().size()));
+
+    StaticAsset asset;
+    asset.body = readFile(path);
+    asset.etag = etagOf(asset.body);
+    asset.contentType = contentTypeOf(path);
+    auto compressed = gzip(asset.body);
+    if (compressed.size() < asset.body.size()) {
+      asset.gzipBody = std::move(compressed);
+      asset.gzipEtag = etagOf(asset.body, "-gz");
+    }
+    assets.emplace(relative, std::move(asset));
+  }
+
+  // Directories are served by their index.html
+  std::vector<std::pair<std::string, StaticAsset>> indexes;
+  for (const auto& [path, asset] : assets) {
+    fs::path p { path };
+    if (p.filename() == "index.html") {
+      indexes.emplace_back(p.parent_path().generic_string(), asset);
+    }
+  }
+  for (auto& [path, asset] : indexes) {
+    assets.emplace(path, std::move(asset));
+  }
+}
+
+const StaticAsset* StaticAssets::find(const std::string& path) const
+{
+  auto asset = assets.find(trimSlashes(path));
+  if (asset == assets.end()) {
+    return nullptr;
+  }
+  return &asset->second;
+}
+
+size_t StaticAssets::size() const { return assets.size(); }
+
+bool etag_matches(const std::string& ifNoneMatch, const std::string& etag)
+{
+  std::istringstream ss(ifNoneMatch);
+  for (std::string candidate; std::getline(ss, candidate, ',');) {
+    candidate = trimSpaces(candidate);
+    if (candidate.compare(0, 2, "W/") == 0) {
+      candidate = candidate.substr(2);
+    }
+    if (candidate == "*" || candidate == etag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool accepts_gzip(const std::string& acceptEncoding)
+{
+  // An explicit gzip entry wins over the wildcard, wherever it is listed.
+  std::optional<bool> gzipAllowed;
+  std::optional<bool> wildcardAllowed;
+  std::istringstream ss(acceptEncoding);
+  for (std::string coding; std::getline(ss, coding, ',');) {
+    auto params = coding.find(';');
+    auto name = trimSpaces(coding.substr(0, params));
+    std::transform(name.begin(), name.end(), name.begin(),
+        [](unsigned char c) { return std::tolower(c); });
+    if (name != "gzip" && name != "*") {
+      continue;
+    }
+    bool allowed = true;
+    if (params != std::string::npos) {
+      auto q = trimSpaces(coding.substr(params + 1));
+      if (q.compare(0, 2, "q=") == 0) {
+        // A q value that is no number counts as q=0
+        auto value = q.substr(2);
+        char* end = nullptr;
+        double weight = std::strtod(value.c_str(), &end);
+        allowed = !value.empty() && end == value.c_str() + value.size() && weight > 0;
+      }
+    }
+    (name == "gzip" ? gzipAllowed : wildcardAllowed) = allowed;
+  }
+  return gzipAllowed.value_or(wildcardAllowed.value_or(false));
+}
@@ -0,0 +1,59 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef STATIC_ASSETS_H
+#define STATIC_ASSETS_H
+
+#include <string>
+#include <unordered_map>
+
+struct StaticAsset {
+  std::string body;
+  // empty if compressing does not pay off
+  std::string gzipBody;
+  // strong validators differ between the identity and the gzip body
+  std::string etag;
+  std::string gzipEtag;
+  std::string contentType;
+};
+
+// Immutable in-memory copy of the web root. Everything is read and compressed
+// once at startup, so serving a file needs neither file system access nor
+// path canonicalization. Only files below the root can ever be found.
+class StaticAssets {
+  public:
+  StaticAssets() = delete;
+  StaticAssets(const std::string& webRoot);
+  StaticAssets(const StaticAssets& other) = delete;
+  StaticAssets(StaticAssets&& other) noexcept = default;
+  virtual ~StaticAssets() noexcept = default;
+  StaticAssets& operator=(const StaticAssets& other) = delete;
+  StaticAssets& operator=(StaticAssets&& other) noexcept = default;
+
+  // path relative to the web root, a directory resolves to its index.html
+  const StaticAsset* find(const std::string& path) const;
+  size_t size() const;
+
+  private:
+  std::unordered_map<std::string, StaticAsset> assets;
+};
+
+bool etag_matches(const std::string& ifNoneMatch, const std::string& etag);
+bool accepts_gzip(const std::string& acceptEncoding);
+
+#endif /* STATIC_ASSETS_H */
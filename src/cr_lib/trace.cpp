@@ -0,0 +1,187 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+const auto processStart = std::chrono::steady_clock::now();
+std::atomic<uint32_t> nextThreadId { 0 };
+
+struct Ring {
+  std::vector<TraceEvent> events;
+  uint64_t written = 0;
+  uint32_t thread;
+
+  Ring()
+      : events(Trace::CAPACITY)
+      , thread(nextThreadId++)
+  {
+  }
+
+  void push(const char* name, uint64_t start, uint64_t duration, bool instant,
+      const TraceField* fields, size_t count)
+  {
+    auto& e = events[written % Trace::CAPACITY];
+    e.name = name;
+    e.start = start;
+    e.duration = duration;
+    e.instant = instant;
+    e.thread = thread;
+    e.fieldCount = static_cast<uint8_t>(std::min(count, TraceEvent::MAX_FIELDS));
+    std::copy(fields, fields + e.fieldCount, e.fields.begin());
+    ++written;
+  }
+};
+
+Ring& ring()
+{
+  thread_local Ring r;
+  return r;
+}
+
+void appendField(std::string& out, const TraceField& field)
+{
+  char buffer[32];
+  out += field.key;
+  out += '=';
+  switch (field.type) {
+  case TraceField::Type::Int:
+    out += std::to_string(field.i);
+    break;
+  case TraceField::Type::UInt:
+    out += std::to_string(field.u);
+    break;
+  case TraceField::Type::Double:
+    std::snprintf(buffer, sizeof(buffer), "%g", field.d);
+    out += buffer;
+    break;
+  case TraceField::Type::String:
+    out += field.s;
+    break;
+  }
+}
+
+void appendMillis(std::string& out, uint64_t ns)
+{
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.3fms", ns / 1e6);
+  out += buffer;
+}
+}
+
+uint64_t Trace::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - processStart)
+      .count();
+}
+
+void Trace::event(const char* name, std::initializer_list<TraceField> fields)
+{
+  ring().push(name, now(), 0, true, fields.begin(), fields.size());
+}
+
+void Trace::complete(const char* name, uint64_t start, const TraceField* fields, size_t count)
+{
+  ring().push(name, start, now() - start, false, fields, count);
+}
+
+uint64_t Trace::mark() { return ring().written; }
+
+std::vector<TraceEvent> Trace::since(uint64_t mark, size_t* dropped)
+{
+  const auto& r = ring();
+  auto first = mark;
+  if (r.written > CAPACITY && first < r.written - CAPACITY) {
+    first = r.written - CAPACITY;
+  }
+  if (dropped) {
+    *dropped = first - mark;
+  }
+
+  std::vector<TraceEvent> events;
+  events.reserve(r.written - first);
+  for (auto i = first; i < r.written; ++i) {
+    events.push_back(r.events[i % CAPACITY]);
+  }
+  // Complete events are recorded when they end, nested ones come first.
+  std::stable_sort(events.begin(), events.end(),
+      [](const TraceEvent& a, const TraceEvent& b) { return a.start < b.start; });
+  return events;
+}
+
+std::string Trace::to_text(const std::vector<TraceEvent>& events, size_t dropped)
+{
+  std::string out;
+  if (dropped > 0) {
+    out += std::to_string(dropped) + " older events were dropped\n";
+  }
+  if (events.empty()) {
+    return out;
+  }
+
+  const auto origin = events.front().start;
+  std::vector<uint64_t> open;
+  for (const auto& e : events) {
+    while (!open.empty() && open.back() <= e.start) {
+      open.pop_back();
+    }
+
+    appendMillis(out, e.start - origin);
+    out.append(2 * open.size() + 1, ' ');
+    out += e.name;
+    if (!e.instant) {
+      out += ' ';
+      appendMillis(out, e.duration);
+    }
+    for (size_t i = 0; i < e.fieldCount; ++i) {
+      out += ' ';
+      appendField(out, e.fields[i]);
+    }
+    out += '\n';
+
+    if (!e.instant) {
+      open.push_back(e.start + e.duration);
+    }
+  }
+  return out;
+}
+
+TraceSpan::TraceSpan(const char* name, std::initializer_list<TraceField> fields)
+    : name(name)
+    , start(Trace::now())
+{
+  for (const auto& f : fields) {
+    if (count < TraceEvent::MAX_FIELDS) {
+      this->fields[count++] = f;
+    }
+  }
+}
+
+void TraceSpan::end()
+{
+  if (!ended) {
+    ended = true;
+    Trace::complete(name, start, fields.data(), count);
+  }
+}
@@ -0,0 +1,129 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Typed key value pair attached to trace events. Keys and string values have
+// to be string literals, they are stored as pointers.
+struct TraceField {
+  enum class Type : uint8_t { Int, UInt, Double, String };
+
+  const char* key = nullptr;
+  Type type = Type::Int;
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+    const char* s;
+  };
+
+  TraceField()
+      : i(0)
+  {
+  }
+
+  template <class T>
+  TraceField(const char* key, T value)
+      : key(key)
+  {
+    if constexpr (std::is_floating_point_v<T>) {
+      type = Type::Double;
+      d = value;
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+      type = Type::Int;
+      i = value;
+    } else if constexpr (std::is_integral_v<T>) {
+      type = Type::UInt;
+      u = value;
+    } else {
+      static_assert(std::is_convertible_v<T, const char*>, "unsupported trace field type");
+      type = Type::String;
+      s = value;
+    }
+  }
+};
+
+// A single event in the Chrome trace event model: either an instant event or
+// a complete event with duration.
+struct TraceEvent {
+  static constexpr size_t MAX_FIELDS = 4;
+
+  const char* name;
+  uint64_t start; // ns since process start
+  uint64_t duration; // ns, 0 for instant events
+  bool instant;
+  uint8_t fieldCount;
+  uint32_t thread;
+  std::array<TraceField, MAX_FIELDS> fields;
+};
+
+// Every thread records into its own fixed size ring buffer, so recording is
+// a few stores without locking or allocation. Events are only formatted when
+// somebody asks for them.
+class Trace {
+  public:
+  static constexpr size_t CAPACITY = 1024;
+
+  static uint64_t now();
+  static void event(const char* name, std::initializer_list<TraceField> fields = {});
+  static void complete(const char* name, uint64_t start, const TraceField* fields, size_t count);
+
+  // Position in the current thread's buffer, used to collect the events
+  // recorded after it.
+  static uint64_t mark();
+  // Events of the current thread recorded since mark, ordered by start time.
+  // Events overwritten in the meantime are counted in dropped.
+  static std::vector<TraceEvent> since(uint64_t mark, size_t* dropped = nullptr);
+
+  static std::string to_text(const std::vector<TraceEvent>& events, size_t dropped = 0);
+};
+
+// Records a complete event covering its lifetime. Fields can be added until
+// it ends, e.g. counters only known at the end.
+class TraceSpan {
+  public:
+  TraceSpan(const char* name, std::initializer_list<TraceField> fields = {});
+  TraceSpan(const TraceSpan& other) = delete;
+  TraceSpan& operator=(const TraceSpan& other) = delete;
+  ~TraceSpan() { end(); }
+
+  template <class T> void field(const char* key, T value)
+  {
+    if (count < TraceEvent::MAX_FIELDS) {
+      fields[count++] = TraceField { key, value };
+    }
+  }
+  void end();
+
+  private:
+  const char* name;
+  uint64_t start;
+  bool ended = false;
+  uint8_t count = 0;
+  std::array<TraceField, TraceEvent::MAX_FIELDS> fields;
+};
+
+#endif /* TRACE_H */
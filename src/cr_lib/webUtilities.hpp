@@ -18,15 +18,22 @@
 #ifndef WEBUTILITIES_H
 #define WEBUTILITIES_H
 
+#include "grid.hpp"
+#include "polyline_simplification.hpp"
 #include "routeComparator.hpp"
+#include "route_batch.hpp"
+#include "trace.hpp"
 
 #include "server_http.hpp"
 #include "json/json.h"
 
+// start and end replace the first and last node of the route, they are the
+// projected points of a query between coordinates.
 template <int Dim>
-Json::Value routeToJson(const Route<Dim>& route, const Graph<Dim>& g, bool writeLogs = false)
+Json::Value routeToJson(const Route<Dim>& route, const Graph<Dim>& g, double tolerance = 0.0,
+    std::optional<LatLng> start = {}, std::optional<LatLng> end = {})
 {
-  using Edge = Edge<Dim>;
+  const auto& edges = g.getEdges();
 
   Json::Value result;
   Json::Value costs(Json::arrayValue);
@@ -36,42 +43,85 @@ Json::Value routeToJson(const Route<Dim>& route, const Graph<Dim>& g, bool write
   }
   result["costs"] = costs;
 
-  if (writeLogs) {
-    auto log = Logger::getInstance();
-    result["debug"] = log->getInfo();
-  }
   Json::Value js_route;
   js_route["type"] = "Feature";
 
   Json::Value geometry;
   geometry["type"] = "LineString";
 
-  std::unordered_set<NodeId> nodes;
-  nodes.reserve(route.edges.size());
+  struct Point {
+    PositionalNode position;
+    double height;
+  };
+  std::vector<Point> points;
+  points.reserve(route.edges.size() + 1);
+  auto addNode = [&g, &points](NodePos pos) {
+    const auto& node = g.getNode(pos);
+    const double height = node.height();
+    points.push_back(Point { PositionalNode { node.lat(), node.lng(), pos }, height });
+  };
   for (const auto& edge : route.edges) {
-    nodes.insert(Edge::getSourceId(edge));
-    nodes.insert(Edge::getDestId(edge));
-  }
-
-  Json::Value coordinates(Json::arrayValue);
-
-  for (const auto& edge : route.edges) {
-    const auto& node = g.getNode(Edge::sourcePos(edge));
-    Json::Value js_node(Json::arrayValue);
-    js_node.append(node.lng().get());
-    js_node.append(node.lat().get());
-    js_node.append(node.height());
-    coordinates.append(js_node);
+    addNode(edges.sourcePos(edge));
   }
   if (!route.edges.empty()) {
-    const auto& lastEdge = route.edges[route.edges.size() - 1];
-    const auto& endNode = g.getNode(Edge::destPos(lastEdge));
+    addNode(edges.destPos(route.edges.back()));
+  }
+  // Projected points take the height of the node they replace.
+  if (start && !points.empty()) {
+    points.front().position.lat = start->lat;
+    points.front().position.lng = start->lng;
+  }
+  if (end && !points.empty()) {
+    points.back().position.lat = end->lat;
+    points.back().position.lng = end->lng;
+  }
 
+  auto pointToJson = [](const Point& point) {
     Json::Value js_node(Json::arrayValue);
-    js_node.append(endNode.lng().get());
-    js_node.append(endNode.lat().get());
-    js_node.append(endNode.height());
-    coordinates.append(js_node);
+    js_node.append(point.position.lng.get());
+    js_node.append(point.position.lat.get());
+    js_node.append(point.height);
+    return js_node;
+  };
+
+  Json::Value coordinates(Json::arrayValue);
+  if (tolerance > 0 && points.size() > 2) {
+    std::vector<LatLng> latLngs;
+    latLngs.reserve(points.size());
+    for (const auto& point : points) {
+      latLngs.push_back(LatLng { point.position.lat, point.position.lng });
+    }
+    for (auto i : simplify_polyline(latLngs, tolerance)) {
+      coordinates.append(pointToJson(points[i]));
+    }
+
+    // The simplified geometry drops most nodes, so the height profile is sent
+    // next to it as (distance, height) samples. Heights vary much less than
+    // positions, a tenth of the tolerance keeps the climbs recognisable.
+    std::vector<double> distances;
+    std::vector<double> heightValues;
+    distances.reserve(points.size());
+    heightValues.reserve(points.size());
+    double distance = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+      if (i > 0) {
+        distance += haversine_distance(points[i - 1].position, points[i].position);
+      }
+      distances.push_back(distance);
+      heightValues.push_back(points[i].height);
+    }
+    Json::Value heights(Json::arrayValue);
+    for (auto i : simplify_profile(distances, heightValues, tolerance / 10)) {
+      Json::Value sample(Json::arrayValue);
+      sample.append(distances[i]);
+      sample.append(heightValues[i]);
+      heights.append(sample);
+    }
+    js_route["properties"]["heights"] = heights;
+  } else {
+    for (const auto& point : points) {
+      coordinates.append(pointToJson(point));
+    }
   }
 
   geometry["coordinates"] = coordinates;
@@ -81,6 +131,88 @@ Json::Value routeToJson(const Route<Dim>& route, const Graph<Dim>& g, bool write
   return result;
 }
 
+// Reads the optional "tolerance" (meters) or "zoom" (web mercator zoom level)
+// parameter. Returns 0 if the route should not be simplified.
+template <int Dim>
+double extractSimplificationTolerance(const SimpleWeb::CaseInsensitiveMultimap& queryFields,
+    const Route<Dim>& route, const Graph<Dim>& g)
+{
+  for (const auto& field : queryFields) {
+    if (field.first == "tolerance") {
+      return std::max(0.0, stod(field.second));
+    } else if (field.first == "zoom" && !route.edges.empty()) {
+      const auto& node = g.getNode(g.getEdges().sourcePos(route.edges.front()));
+      return zoom_to_tolerance(stod(field.second), node.lat());
+    }
+  }
+  return 0.0;
+}
+
+// Converts trace events to the Chrome trace event format, the result can be
+// saved as a file and opened in chrome://tracing or Perfetto.
+inline Json::Value traceToJson(const std::vector<TraceEvent>& events)
+{
+  Json::Value traceEvents(Json::arrayValue);
+  for (const auto& e : events) {
+    Json::Value event;
+    event["name"] = e.name;
+    event["ph"] = e.instant ? "i" : "X";
+    event["ts"] = e.start / 1000.0;
+    if (!e.instant) {
+      event["dur"] = e.duration / 1000.0;
+    }
+    event["pid"] = 1;
+    event["tid"] = e.thread;
+
+    Json::Value args(Json::objectValue);
+    for (size_t i = 0; i < e.fieldCount; ++i) {
+      const auto& field = e.fields[i];
+      switch (field.type) {
+      case TraceField::Type::Int:
+        args[field.key] = static_cast<Json::Int64>(field.i);
+        break;
+      case TraceField::Type::UInt:
+        args[field.key] = static_cast<Json::UInt64>(field.u);
+        break;
+      case TraceField::Type::Double:
+        args[field.key] = field.d;
+        break;
+      case TraceField::Type::String:
+        args[field.key] = field.s;
+        break;
+      }
+    }
+    event["args"] = args;
+    traceEvents.append(event);
+  }
+
+  Json::Value trace;
+  trace["traceEvents"] = traceEvents;
+  trace["displayTimeUnit"] = "ms";
+  return trace;
+}
+
+// With the query parameter "debug" the "debug" field gets a readable form of
+// the events recorded on this thread since mark, with "trace" they are added
+// in the Chrome trace format. Without either nothing is serialized.
+inline void addTraceToJson(Json::Value& result, uint64_t mark,
+    const SimpleWeb::CaseInsensitiveMultimap& queryFields)
+{
+  const bool debug = queryFields.find("debug") != queryFields.end();
+  const bool trace = queryFields.find("trace") != queryFields.end();
+  if (!debug && !trace) {
+    return;
+  }
+  size_t dropped = 0;
+  auto events = Trace::since(mark, &dropped);
+  if (debug) {
+    result["debug"] = Trace::to_text(events, dropped);
+  }
+  if (trace) {
+    result["trace"] = traceToJson(events);
+  }
+}
+
 void extractQueryFields(const SimpleWeb::CaseInsensitiveMultimap& queryFields,
     std::optional<uint32_t>& s, std::optional<uint32_t>& t, std::optional<uint32_t>& length,
     std::optional<uint32_t>& height, std::optional<uint32_t>& unsuitability)
@@ -100,4 +232,96 @@ void extractQueryFields(const SimpleWeb::CaseInsensitiveMultimap& queryFields,
   }
 }
 
+// Reads a coordinate given as <prefix>_lat and <prefix>_lng.
+inline std::optional<LatLng> extractCoordinate(
+    const SimpleWeb::CaseInsensitiveMultimap& queryFields, const std::string& prefix)
+{
+  std::optional<double> lat {}, lng {};
+  for (const auto& field : queryFields) {
+    if (field.first == prefix + "_lat") {
+      lat = stod(field.second);
+    } else if (field.first == prefix + "_lng") {
+      lng = stod(field.second);
+    }
+  }
+  if (!lat || !lng) {
+    return {};
+  }
+  return LatLng { Lat { *lat }, Lng { *lng } };
+}
+
+// Parses the body of a snapping request: an array of objects with "lat" and
+// "lng".
+inline std::vector<LatLng> parseCoordinates(const Json::Value& body)
+{
+  if (!body.isArray()) {
+    throw std::invalid_argument("Batch request needs to be a JSON array");
+  }
+  std::vector<LatLng> coordinates;
+  coordinates.reserve(body.size());
+  for (const auto& entry : body) {
+    if (!entry.isObject() || !entry["lat"].isNumeric() || !entry["lng"].isNumeric()) {
+      throw std::invalid_argument("Every coordinate needs lat and lng");
+    }
+    coordinates.push_back(
+        LatLng { Lat { entry["lat"].asDouble() }, Lng { entry["lng"].asDouble() } });
+  }
+  return coordinates;
+}
+
+// Parses the body of a batch request: an array of objects with "config" (one
+// weight per metric) and either node positions "s" and "t" or coordinates
+// "s_lat", "s_lng", "t_lat" and "t_lng".
+template <int Dim>
+std::vector<BatchQuery<Dim>> parseBatchQueries(const Json::Value& body, size_t nodeCount)
+{
+  if (!body.isArray()) {
+    throw std::invalid_argument("Batch request needs to be a JSON array");
+  }
+
+  auto readEndpoint = [nodeCount](const Json::Value& entry, const std::string& name,
+                          std::optional<NodePos>& pos, std::optional<LatLng>& coord) {
+    const auto& id = entry[name];
+    const auto& lat = entry[name + "_lat"];
+    const auto& lng = entry[name + "_lng"];
+    if (id.isUInt()) {
+      if (id.asUInt() >= nodeCount) {
+        throw std::invalid_argument("Request contains illegal node ids");
+      }
+      pos = NodePos { id.asUInt() };
+    } else if (lat.isNumeric() && lng.isNumeric()) {
+      coord = LatLng { Lat { lat.asDouble() }, Lng { lng.asDouble() } };
+    } else {
+      throw std::invalid_argument("Every query needs " + name + " or " + name + "_lat and "
+          + name + "_lng");
+    }
+  };
+
+  std::vector<BatchQuery<Dim>> queries;
+  queries.reserve(body.size());
+  for (const auto& entry : body) {
+    if (!entry.isObject()) {
+      throw std::invalid_argument("Every query needs to be a JSON object");
+    }
+    const auto& config = entry["config"];
+    if (!config.isArray() || config.size() != Dim) {
+      throw std::invalid_argument(
+          "Every query needs a config with " + std::to_string(Dim) + " values");
+    }
+    std::vector<double> values;
+    for (const auto& v : config) {
+      if (!v.isNumeric()) {
+        throw std::invalid_argument("Config values need to be numbers");
+      }
+      values.push_back(v.asDouble());
+    }
+
+    BatchQuery<Dim> query { {}, {}, {}, {}, Config<Dim> { values } };
+    readEndpoint(entry, "s", query.s, query.sCoord);
+    readEndpoint(entry, "t", query.t, query.tCoord);
+    queries.push_back(std::move(query));
+  }
+  return queries;
+}
+
 #endif /* WEBUTILITIES_H */
@@ -19,18 +19,24 @@
 #include "dijkstra.hpp"
 #include "edge_load.hpp"
 #include "enumerate_optimals.hpp"
+#include "experiment_driver.hpp"
 #include "graph_loading.hpp"
 #include "grid.hpp"
 #include "ilp_independent_set.hpp"
 #include "naive_exploration.hpp"
+#include "pareto_search.hpp"
 #include "routeComparator.hpp"
 #include "url_parsing.hpp"
 
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <sstream>
+#include <thread>
 
 namespace po = boost::program_options;
 namespace c = std::chrono;
@@ -41,66 +47,109 @@ void printErrorAndHelp(const std::string& error, const po::options_description&
   std::cout << all << '\n';
 }
 
+struct CoordinatePair {
+  double s_lat, s_lng, t_lat, t_lng;
+  std::optional<NodePos> s, t;
+};
+
+// Reads all "s_lat s_lng t_lat t_lng" lines of input and snaps their
+// coordinates to nodes in one batch.
+std::vector<CoordinatePair> read_coordinate_pairs(std::istream& input, const Grid& grid)
+{
+  std::vector<CoordinatePair> pairs;
+  std::vector<LatLng> coordinates;
+  double s_lat, s_lng, t_lat, t_lng;
+  while (input >> s_lat >> s_lng >> t_lat >> t_lng) {
+    pairs.push_back(CoordinatePair { s_lat, s_lng, t_lat, t_lng, {}, {} });
+    coordinates.push_back(LatLng { Lat { s_lat }, Lng { s_lng } });
+    coordinates.push_back(LatLng { Lat { t_lat }, Lng { t_lng } });
+  }
+
+  auto nodes = grid.findNextNodes(coordinates);
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    pairs[i].s = nodes[2 * i];
+    pairs[i].t = nodes[2 * i + 1];
+  }
+  return pairs;
+}
+
+
+struct StPair {
+  std::string type;
+  uint32_t from;
+  uint32_t to;
+};
+
+// Reads the "from to" lines of a tour file, pairs with equal nodes are left
+// out.
+std::vector<StPair> read_pairs(const std::string& fileName, const std::string& type)
+{
+  std::vector<StPair> pairs;
+  std::ifstream file { fileName };
+  for (uint32_t from, to; file >> from >> to;) {
+    if (from != to) {
+      pairs.push_back(StPair { type, from, to });
+    }
+  }
+  return pairs;
+}
+
+// Engines of one thread of the experiment driver, reused for all its jobs.
+template <int Dim> struct ExperimentWorker {
+  Dijkstra<Dim> d;
+  std::unique_ptr<ParetoSearch<Dim>> pareto;
+  std::unique_ptr<EnumerateOptimals<Dim, SimilarityPrio>> enumerate;
+};
+template <int Dim> using Job = ExperimentJob<ExperimentWorker<Dim>>;
+
 template <int Dim>
-void explore_random(std::ifstream& file, std::ofstream& output, Dijkstra<Dim>& d, size_t splitCount,
-    double maxSimilarity, std::string type)
+std::string explore_random(
+    Dijkstra<Dim>& d, const StPair& pair, size_t splitCount, double maxSimilarity)
 {
   using Route = Route<Dim>;
+  const auto& [type, from, to] = pair;
 
-  auto counter = 0;
-  while (!file.eof()) {
-    uint32_t from;
-    uint32_t to;
-    file >> from >> to;
-    if (from == to) {
-      continue;
-    }
-    if (file.eof()) {
-      break;
-    }
-    if (++counter % 20 == 0) {
-      output.flush();
+  try {
+    std::vector<Route> routes;
+    auto start = c::high_resolution_clock::now();
+    for (size_t i = 0; i < splitCount * 3; ++i) {
+      routes.push_back(
+          d.findBestRoute(NodePos { from }, NodePos { to }, generateRandomConfig<Dim>()).value());
     }
-    try {
-      std::vector<Route> routes;
-      auto start = c::high_resolution_clock::now();
-      for (size_t i = 0; i < splitCount * 3; ++i) {
-        routes.push_back(
-            d.findBestRoute(NodePos { from }, NodePos { to }, generateRandomConfig<Dim>()).value());
-      }
-      auto end = c::high_resolution_clock::now();
-      size_t exploreTime = c::duration_cast<ms>(end - start).count();
-
-      std::vector<std::pair<size_t, size_t>> edges;
-      for (size_t i = 0; i < routes.size(); ++i) {
-        for (size_t j = i + 1; j < routes.size(); ++j) {
-          if (calculateSharing(routes[i], routes[j]) > maxSimilarity) {
-            edges.emplace_back(i, j);
-          }
+    auto end = c::high_resolution_clock::now();
+    size_t exploreTime = c::duration_cast<ms>(end - start).count();
+
+    std::vector<std::pair<size_t, size_t>> edges;
+    for (size_t i = 0; i < routes.size(); ++i) {
+      for (size_t j = i + 1; j < routes.size(); ++j) {
+        if (calculateSharing(routes[i], routes[j]) > maxSimilarity) {
+          edges.emplace_back(i, j);
         }
       }
-      start = c::high_resolution_clock::now();
-      auto ilpSet = find_independent_set(routes.size(), edges);
-      end = c::high_resolution_clock::now();
-      size_t ilp_recommendation_time = c::duration_cast<ms>(end - start).count();
-
-      duplicate_edges(edges);
-      start = c::high_resolution_clock::now();
-      auto greedySet = greedy_independent_set(routes.size(), edges);
-      end = c::high_resolution_clock::now();
-      size_t greedy_recommendation_time = c::duration_cast<ms>(end - start).count();
-
-      output << type << "," << from << "," << to << "," << routes.size() << "," << maxSimilarity
-             << "," << routes.size() << "," << ilpSet.size() << "," << greedySet.size() << ","
-             << exploreTime << "," << ilp_recommendation_time << "," << greedy_recommendation_time
-             << '\n';
-    } catch (...) {
-      continue;
     }
+    start = c::high_resolution_clock::now();
+    auto ilpSet = find_independent_set(routes.size(), edges);
+    end = c::high_resolution_clock::now();
+    size_t ilp_recommendation_time = c::duration_cast<ms>(end - start).count();
+
+    duplicate_edges(edges);
+    start = c::high_resolution_clock::now();
+    auto greedySet = greedy_independent_set(routes.size(), edges);
+    end = c::high_resolution_clock::now();
+    size_t greedy_recommendation_time = c::duration_cast<ms>(end - start).count();
+
+    std::ostringstream output;
+    output << type << "," << from << "," << to << "," << routes.size() << "," << maxSimilarity
+           << "," << routes.size() << "," << ilpSet.size() << "," << greedySet.size() << ","
+           << exploreTime << "," << ilp_recommendation_time << "," << greedy_recommendation_time
+           << '\n';
+    return output.str();
+  } catch (...) {
+    return {};
   }
 }
 
-template <int Dim> void load_histogramm(Graph<Dim>& g, Grid& grid)
+template <int Dim> void load_histogramm(Graph<Dim>& g, const Grid& grid)
 {
 
   while (std::cin) {
@@ -148,95 +197,113 @@ template <int Dim> void load_histogramm(Graph<Dim>& g, Grid& grid)
 }
 
 template <int Dim>
-void enumerate(std::ifstream& file, std::ofstream& output, Graph<Dim>* g, size_t maxRoutes,
-    double maxSimilarity, std::string type)
+std::string enumerate(Dijkstra<Dim>& d, Graph<Dim>* g, const StPair& pair, size_t maxRoutes,
+    double maxSimilarity, size_t threads)
 {
   using Route = Route<Dim>;
-  auto d = g->createDijkstra();
-  auto counter = 0;
-  while (!file.eof()) {
-    uint32_t from;
-    uint32_t to;
-    file >> from >> to;
-    if (from == to) {
-      continue;
-    }
-    if (file.eof()) {
-      break;
-    }
-    if (++counter % 20 == 0) {
-      output.flush();
-    }
-    std::vector<double> conf(Dim, 0);
-    conf[0] = 1;
-
-    if (!d.findBestRoute(NodePos { from }, NodePos { to }, conf)) {
-      std::cout << "did not find routes"
-                << "\n";
-      continue;
-    }
-    try {
-      EnumerateOptimals<Dim, SimilarityPrio> o(g, maxRoutes);
-      o.set_overlap(maxSimilarity);
-
-      std::vector<Route> routes;
-      o.find(NodePos { from }, NodePos { to });
-
-      std::tie(routes, std::ignore) = o.recommend_routes(true);
-      auto routes_recommended_ilp = routes.size();
-      auto ilp_time = o.recommendation_time;
-
-      std::tie(routes, std::ignore) = o.recommend_routes(false);
-      auto routes_recommended_greedy = routes.size();
-      auto greedy_time = o.recommendation_time;
-
-      auto routeCount = o.found_route_count();
+  const auto& [type, from, to] = pair;
+  std::vector<double> conf(Dim, 0);
+  conf[0] = 1;
 
-      output << type << "," << from << "," << to << "," << maxRoutes << "," << maxSimilarity << ","
-             << routeCount << "," << routes_recommended_ilp << "," << routes_recommended_greedy
-             << "," << o.enumeration_time << "," << ilp_time << "," << greedy_time << '\n';
-    } catch (...) {
-      continue;
-    }
+  if (!d.findBestRoute(NodePos { from }, NodePos { to }, conf)) {
+    std::cout << "did not find routes"
+              << "\n";
+    return {};
+  }
+  try {
+    EnumerateOptimals<Dim, SimilarityPrio> o(g, maxRoutes, threads);
+    o.set_overlap(maxSimilarity);
+
+    std::vector<Route> routes;
+    o.find(NodePos { from }, NodePos { to });
+
+    std::tie(routes, std::ignore) = o.recommend_routes(true);
+    auto routes_recommended_ilp = routes.size();
+    auto ilp_time = o.recommendation_time;
+
+    std::tie(routes, std::ignore) = o.recommend_routes(false);
+    auto routes_recommended_greedy = routes.size();
+    auto greedy_time = o.recommendation_time;
+
+    auto routeCount = o.found_route_count();
+
+    std::ostringstream output;
+    output << type << "," << from << "," << to << "," << maxRoutes << "," << maxSimilarity << ","
+           << routeCount << "," << routes_recommended_ilp << "," << routes_recommended_greedy
+           << "," << o.enumeration_time << "," << ilp_time << "," << greedy_time << '\n';
+    return output.str();
+  } catch (...) {
+    return {};
   }
 }
 
 template <int Dim>
-void enumerate_all(std::ifstream& file, std::ofstream& output, Graph<Dim>* g, std::string type)
+std::string enumerate_all(Dijkstra<Dim>& d, Graph<Dim>* g, const StPair& pair, size_t threads)
 {
   using Route = Route<Dim>;
-  uint32_t from;
-  uint32_t to;
-  int counter = 0;
+  const auto& [type, from, to] = pair;
   std::vector<double> conf(Dim, 0);
   conf[0] = 1;
-  auto d = g->createDijkstra();
-  while (file >> from >> to) {
-    if (!d.findBestRoute(NodePos { from }, NodePos { to }, conf)) {
-      std::cout << "did not find routes"
-                << "\n";
-      continue;
-    }
-    try {
-      if (++counter % 20 == 0) {
-        std::cout << "finished " << counter << " s-t pairs" << '\n';
-        output.flush();
-      }
-      EnumerateOptimals<Dim, SimilarityPrio> o(g, std::numeric_limits<size_t>::max());
+  if (!d.findBestRoute(NodePos { from }, NodePos { to }, conf)) {
+    std::cout << "did not find routes"
+              << "\n";
+    return {};
+  }
+  try {
+    EnumerateOptimals<Dim, SimilarityPrio> o(g, std::numeric_limits<size_t>::max(), threads);
 
-      std::vector<Route> routes;
-      o.find(NodePos { from }, NodePos { to });
+    std::vector<Route> routes;
+    o.find(NodePos { from }, NodePos { to });
 
-      std::tie(routes, std::ignore) = o.recommend_routes(true);
+    std::tie(routes, std::ignore) = o.recommend_routes(true);
 
-      auto routes_recommended = routes.size();
+    auto routes_recommended = routes.size();
 
-      output << type << "," << from << "," << to << "," << routes_recommended << ","
-             << o.enumeration_time << '\n';
-    } catch (...) {
-      continue;
-    }
+    std::ostringstream output;
+    output << type << "," << from << "," << to << "," << routes_recommended << ","
+           << o.enumeration_time << '\n';
+    return output.str();
+  } catch (...) {
+    return {};
+  }
+}
+
+// Computes the complete Pareto set of the s-t pair and checks how many of the
+// routes found by the enumeration lie on it.
+template <int Dim>
+std::string compare_pareto(
+    ParetoSearch<Dim>& pareto, Graph<Dim>* g, const StPair& pair, size_t threads)
+{
+  const auto& [type, from, to] = pair;
+  auto start = c::high_resolution_clock::now();
+  auto front = pareto.run(NodePos { from }, NodePos { to });
+  auto end = c::high_resolution_clock::now();
+  if (front.empty()) {
+    std::cout << "did not find routes"
+              << "\n";
+    return {};
+  }
+  EnumerateOptimals<Dim, DefaultsOnly> o(g, std::numeric_limits<size_t>::max(), threads);
+  o.find(NodePos { from }, NodePos { to });
+
+  size_t onFront = 0;
+  for (size_t i = 0; i < o.found_route_count(); ++i) {
+    const auto& costs = o.route(i).costs;
+    onFront += std::any_of(front.begin(), front.end(), [&costs](const auto& route) {
+      for (size_t j = 0; j < Dim; ++j) {
+        if (std::abs(route.costs.values[j] - costs.values[j]) > 1e-6) {
+          return false;
+        }
+      }
+      return true;
+    });
   }
+
+  std::ostringstream output;
+  output << type << "," << from << "," << to << "," << front.size() << "," << pareto.labelCount
+         << "," << c::duration_cast<c::milliseconds>(end - start).count() << ","
+         << o.found_route_count() << "," << onFront << "," << o.enumeration_time << '\n';
+  return output.str();
 }
 
 template <int Dim> void search_candidates(Graph<Dim>& g, size_t count)
@@ -328,174 +395,182 @@ template <int Dim> void search_commuting_candidates(Graph<Dim>& g)
 }
 
 template <int Dim>
-void explore_naive(std::ifstream& route_input, std::ofstream& output, Dijkstra<Dim>& d,
-    double epsilon, double maxSimilarity, std::string type)
+std::string explore_naive(
+    Dijkstra<Dim>& d, const StPair& pair, double epsilon, double maxSimilarity)
 {
-  int counter = 0;
-  for (uint32_t from, to; route_input >> from >> to;) {
-    if (++counter % 20 == 0) {
-      output.flush();
-    }
-    try {
-      auto start = c::high_resolution_clock::now();
-      auto routes = naiveExploration(d, NodePos { from }, NodePos { to }, epsilon);
-      auto end = c::high_resolution_clock::now();
-      size_t exploreTime = c::duration_cast<ms>(end - start).count();
-
-      std::vector<std::pair<size_t, size_t>> edges;
-      for (size_t i = 0; i < routes.size(); ++i) {
-        for (size_t j = i + 1; j < routes.size(); ++j) {
-          if (calculateSharing(routes[i], routes[j]) > maxSimilarity) {
-            edges.emplace_back(i, j);
-          }
+  const auto& [type, from, to] = pair;
+  try {
+    auto start = c::high_resolution_clock::now();
+    auto routes = naiveExploration(d, NodePos { from }, NodePos { to }, epsilon);
+    auto end = c::high_resolution_clock::now();
+    size_t exploreTime = c::duration_cast<ms>(end - start).count();
+
+    std::vector<std::pair<size_t, size_t>> edges;
+    for (size_t i = 0; i < routes.size(); ++i) {
+      for (size_t j = i + 1; j < routes.size(); ++j) {
+        if (calculateSharing(routes[i], routes[j]) > maxSimilarity) {
+          edges.emplace_back(i, j);
         }
       }
-
-      start = c::high_resolution_clock::now();
-      auto ilpSet = find_independent_set(routes.size(), edges);
-      end = c::high_resolution_clock::now();
-      size_t ilp_recommendation_time = c::duration_cast<ms>(end - start).count();
-
-      start = c::high_resolution_clock::now();
-      auto greedySet = greedy_independent_set(routes.size(), edges);
-      end = c::high_resolution_clock::now();
-      size_t greedy_recommendation_time = c::duration_cast<ms>(end - start).count();
-
-      output << type << "," << from << "," << to << "," << routes.size() << "," << maxSimilarity
-             << "," << routes.size() << "," << ilpSet.size() << "," << greedySet.size() << ","
-             << exploreTime << "," << ilp_recommendation_time << "," << greedy_recommendation_time
-             << '\n';
-    } catch (...) {
-      continue;
     }
+
+    start = c::high_resolution_clock::now();
+    auto ilpSet = find_independent_set(routes.size(), edges);
+    end = c::high_resolution_clock::now();
+    size_t ilp_recommendation_time = c::duration_cast<ms>(end - start).count();
+
+    start = c::high_resolution_clock::now();
+    auto greedySet = greedy_independent_set(routes.size(), edges);
+    end = c::high_resolution_clock::now();
+    size_t greedy_recommendation_time = c::duration_cast<ms>(end - start).count();
+
+    // The epsilon takes the place of maxRoutes, the rows of different epsilons
+    // can be told apart when resuming then.
+    std::ostringstream output;
+    output << type << "," << from << "," << to << "," << epsilon << "," << maxSimilarity << ","
+           << routes.size() << "," << ilpSet.size() << "," << greedySet.size() << ","
+           << exploreTime << "," << ilp_recommendation_time << "," << greedy_recommendation_time
+           << '\n';
+    return output.str();
+  } catch (...) {
+    return {};
   }
 }
 
 template <int Dim>
-void restricted_exploration(std::ifstream& input, std::ofstream& output, Grid& g, Graph<Dim>* graph,
-    const std::string& graphfile, std::string restriction_parameters)
+std::string restricted_exploration(Graph<Dim>* graph, const CoordinatePair& pair,
+    const std::string& prefix, std::string restriction_parameters, size_t threads)
 {
-  if (output.tellp() == 0) {
-    output << "s_lat,s_lng,t_lat,t_lng,inputgraph,starttime,restriction_parameters,all_time,#all_"
-              "routes,all_avg_load,all_max_load,restr_time,#restr_routes,restr_avg_load,restr_max_"
-              "load\n";
-  }
-
-  boost::filesystem::path p(graphfile);
-  auto graph_file_name = p.filename();
-  auto now = c::system_clock::to_time_t(c::system_clock::now());
-  auto starttime = std::localtime(&now);
-
+  const auto& [s_lat, s_lng, t_lat, t_lng, s, t] = pair;
   const size_t refinements = std::numeric_limits<size_t>::max();
-  double s_lat, s_lng, t_lat, t_lng;
-
-  while (input >> s_lat >> s_lng >> t_lat >> t_lng) {
-    auto s = g.findNextNode(Lat(s_lat), Lng(s_lng));
-    auto t = g.findNextNode(Lat(t_lat), Lng(t_lng));
-    if (!(s && t)) {
-      std::cerr << "could not find points for " << s_lat << ", " << s_lng << ", " << t_lat << ", "
-                << t_lng << '\n';
-      continue;
-    }
-
-    EnumerateOptimals<Dim, DefaultsOnly> all(graph, refinements);
-    auto start = c::high_resolution_clock::now();
-    all.find(*s, *t);
-    auto result = all.recommend_routes(false);
-    auto end = c::high_resolution_clock::now();
-
-    auto all_time = c::duration_cast<ms>(end - start).count();
-    auto routes = std::get<std::vector<Route<Dim>>>(result);
-    auto all_route_count = routes.size();
-
-    EnumerateOptimals<Dim, OnlyExclusion> restricted(graph, refinements);
-    Slack<Dim> slack
-        = important_metrics_to_array<Dim>(parse_important_metric_list(restriction_parameters));
-    restricted.set_slack(slack);
-    start = c::high_resolution_clock::now();
-    restricted.find(*s, *t);
-    auto result2 = restricted.recommend_routes(false);
-    end = c::high_resolution_clock::now();
-
-    auto restricted_time = c::duration_cast<ms>(end - start).count();
-    auto routes2 = std::get<std::vector<Route<Dim>>>(result2);
-    auto restricted_route_count = routes2.size();
-
-    EdgeLoads all_loads(routes);
-
-    EdgeLoads restr_loads(routes2);
 
-    output << s_lat << ',' << s_lng << ',' << t_lat << ',' << t_lng << ',' << graph_file_name << ','
-           << std::put_time(starttime, "%Y-%m-%d %T") << ',' << '"' << restriction_parameters << '"'
-           << ',' << all_time << ',' << all_route_count << ',' << all_loads.avg_load() << ','
-           << all_loads.max_load() << ',' << restricted_time << ',' << restricted_route_count << ','
-           << restr_loads.avg_load() << ',' << restr_loads.max_load() << '\n';
-    output.flush();
-  }
+  EnumerateOptimals<Dim, DefaultsOnly> all(graph, refinements, threads);
+  auto start = c::high_resolution_clock::now();
+  all.find(*s, *t);
+  auto result = all.recommend_routes(false);
+  auto end = c::high_resolution_clock::now();
+
+  auto all_time = c::duration_cast<ms>(end - start).count();
+  auto routes = std::get<std::vector<Route<Dim>>>(result);
+  auto all_route_count = routes.size();
+
+  EnumerateOptimals<Dim, OnlyExclusion> restricted(graph, refinements, threads);
+  Slack<Dim> slack
+      = important_metrics_to_array<Dim>(parse_important_metric_list(restriction_parameters));
+  restricted.set_slack(slack);
+  start = c::high_resolution_clock::now();
+  restricted.find(*s, *t);
+  auto result2 = restricted.recommend_routes(false);
+  end = c::high_resolution_clock::now();
+
+  auto restricted_time = c::duration_cast<ms>(end - start).count();
+  auto routes2 = std::get<std::vector<Route<Dim>>>(result2);
+  auto restricted_route_count = routes2.size();
+
+  EdgeLoads all_loads(routes);
+
+  EdgeLoads restr_loads(routes2);
+
+  std::ostringstream output;
+  output << prefix << ',' << '"' << restriction_parameters << '"' << ',' << all_time << ','
+         << all_route_count << ',' << all_loads.avg_load() << ',' << all_loads.max_load() << ','
+         << restricted_time << ',' << restricted_route_count << ',' << restr_loads.avg_load() << ','
+         << restr_loads.max_load() << '\n';
+  return output.str();
 }
 
 template <int Dim>
-void explore_s_t_pairs(std::ifstream& input, std::ofstream& output, Grid& g, Graph<Dim>* graph,
-    const std::string& graphfile)
+std::string explore_s_t_pairs(EnumerateOptimals<Dim, SimilarityPrio>& e,
+    const CoordinatePair& pair, const std::string& prefix, size_t refinements,
+    double max_similarity)
 {
-  if (output.tellp() == 0) {
-    output << "s_lat,s_lng,t_lat,t_lng,inputgraph,starttime,R,K,time,#routes,min_similarity,"
-              "max_similarity,avg_similarity\n";
-  }
-  boost::filesystem::path p(graphfile);
-  auto graph_file_name = p.filename();
-  auto now = c::system_clock::to_time_t(c::system_clock::now());
-  auto starttime = std::localtime(&now);
-
-  const size_t refinements = 40;
-  const double max_similarity = 0.5;
-  double s_lat, s_lng, t_lat, t_lng;
-  EnumerateOptimals<Dim, SimilarityPrio> e(graph, refinements);
-  e.set_overlap(max_similarity);
-  while (input >> s_lat >> s_lng >> t_lat >> t_lng) {
-    auto s = g.findNextNode(Lat(s_lat), Lng(s_lng));
-    auto t = g.findNextNode(Lat(t_lat), Lng(t_lng));
-    if (!(s && t)) {
-      std::cerr << "could not find points for " << s_lat << ", " << s_lng << ", " << t_lat << ", "
-                << t_lng << '\n';
-      continue;
+  const auto& [s_lat, s_lng, t_lat, t_lng, s, t] = pair;
+  auto start = c::high_resolution_clock::now();
+  e.find(*s, *t);
+  auto [routes, configs] = e.recommend_routes(false);
+  auto end = c::high_resolution_clock::now();
+
+  auto time = c::duration_cast<ms>(end - start).count();
+  auto route_count = routes.size();
+
+  double min_sim = 1;
+  double max_sim = 0;
+  double sum_sim = 0;
+  double count_sim = 0;
+  for (size_t i = 0; i < routes.size(); ++i) {
+    for (size_t j = i + 1; j < routes.size(); ++j) {
+      double sim = calculateSharing(routes[i], routes[j]);
+      if (sim > max_sim)
+        max_sim = sim;
+      if (sim < min_sim)
+        min_sim = sim;
+      sum_sim += sim;
+      count_sim++;
     }
+  }
+  double avg_sim = sum_sim / count_sim;
+  if (count_sim <= 1) {
+    min_sim = 0;
+    max_sim = 0;
+  }
 
-    auto start = c::high_resolution_clock::now();
-    e.find(*s, *t);
-    auto [routes, configs] = e.recommend_routes(false);
-    auto end = c::high_resolution_clock::now();
-
-    auto time = c::duration_cast<ms>(end - start).count();
-    auto route_count = routes.size();
+  std::ostringstream output;
+  output << prefix << ',' << refinements << ',' << max_similarity << ',' << time << ','
+         << route_count << ',' << min_sim << ',' << max_sim << ',' << avg_sim << '\n';
+  return output.str();
+}
 
-    double min_sim = 1;
-    double max_sim = 0;
-    double sum_sim = 0;
-    double count_sim = 0;
-    for (size_t i = 0; i < routes.size(); ++i) {
-      for (size_t j = i + 1; j < routes.size(); ++j) {
-        double sim = calculateSharing(routes[i], routes[j]);
-        if (sim > max_sim)
-          max_sim = sim;
-        if (sim < min_sim)
-          min_sim = sim;
-        sum_sim += sim;
-        count_sim++;
-      }
-    }
-    double avg_sim = sum_sim / count_sim;
-    if (count_sim <= 1) {
-      min_sim = 0;
-      max_sim = 0;
+// Coordinate pairs snapped to nodes. Pairs without nodes are reported and
+// left out.
+std::vector<CoordinatePair> read_snapped_pairs(std::istream& input, const Grid& g)
+{
+  std::vector<CoordinatePair> pairs;
+  for (const auto& pair : read_coordinate_pairs(input, g)) {
+    if (!(pair.s && pair.t)) {
+      std::cerr << "could not find points for " << pair.s_lat << ", " << pair.s_lng << ", "
+                << pair.t_lat << ", " << pair.t_lng << '\n';
+      continue;
     }
+    pairs.push_back(pair);
+  }
+  return pairs;
+}
 
-    output << s_lat << ',' << s_lng << ',' << t_lat << ',' << t_lng << ',' << graph_file_name << ','
-           << std::put_time(starttime, "%Y-%m-%d %T") << ',' << refinements << ',' << max_similarity
-           << ',' << time << ',' << route_count << ',' << min_sim << ',' << max_sim << ','
-           << avg_sim << '\n';
-    output.flush();
+template <int Dim>
+std::string dijkstra_query(Dijkstra<Dim>& d, NodePos from, NodePos to, const Config<Dim>& conf)
+{
+  auto start = std::chrono::high_resolution_clock::now();
+  auto optRoute = d.findBestRoute(from, to, conf);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto time = std::chrono::duration_cast<ms>(end - start).count();
+
+  if (!optRoute) {
+    std::cerr << "no route found between " << from << " and " << to << '\n';
+    return {};
+  }
+  auto route = *optRoute;
+  std::ostringstream output;
+  output << from << "," << to << ",";
+  for (auto& val : conf.values) {
+    output << val << ",";
   }
+  for (auto& cost : route.costs.values) {
+    output << cost << ",";
+  }
+  output << route.edges.size() << "," << d.pqPops << "," << time << '\n';
+  return output.str();
+}
+
+// Prefix of the rows of the coordinate based experiments and the key made of
+// its coordinates and graph file name.
+std::pair<std::string, std::string> coordinate_prefix(
+    const CoordinatePair& pair, const boost::filesystem::path& graph_file_name, std::tm* starttime)
+{
+  std::ostringstream prefix;
+  prefix << pair.s_lat << ',' << pair.s_lng << ',' << pair.t_lat << ',' << pair.t_lng << ','
+         << graph_file_name << ',' << std::put_time(starttime, "%Y-%m-%d %T");
+  return { prefix.str(),
+    csvKey(pair.s_lat, pair.s_lng, pair.t_lat, pair.t_lng, graph_file_name) };
 }
 
 int main(int argc, char* argv[])
@@ -505,6 +580,7 @@ int main(int argc, char* argv[])
   std::string loadFileName {};
   std::string saveFileName {};
   size_t candidate_count = 0;
+  size_t threads = 0;
 
   po::options_description loading { "Graph Loading Options" };
   // clang-format off
@@ -519,7 +595,9 @@ int main(int argc, char* argv[])
   // clang-format off
   dataConfiguration.add_options()
     ("input,i", po::value<std::string>(&parameterInputFile), "File with parameters to execute on")
-    ("output,o", po::value<std::string>(&saveFileName), "File to store results in");
+    ("output,o", po::value<std::string>(&saveFileName), "File to store results in")
+    ("threads,j", po::value<size_t>(&threads), "worker threads, 0 uses all cores")
+    ("resume", "skip jobs whose rows are already in the output file");
   // clang-format on
 
   std::string restriction_parameter;
@@ -533,6 +611,7 @@ int main(int argc, char* argv[])
     ("naive,n", "naive exploration")
     ("enumerate,e", "enumerate paths")
     ("all", "enumerate all paths")
+    ("pareto", "compare enumerated paths to the complete Pareto set")
     ("st", "Run enumerate on s-t pairs")
     ("restricted,r", po::value<std::string>(&restriction_parameter) , "Compare restricted enumeration to full enumeration")
     ("load,l", "generate data for load histogramm") ;
@@ -563,9 +642,6 @@ int main(int argc, char* argv[])
     return 1;
   }
 
-  Dijkstra d = g.createDijkstra();
-  std::random_device rd {};
-  std::uniform_int_distribution<size_t> dist(0, g.getNodeCount() - 1);
   if (vm.count("candidates") > 0) {
     search_candidates(g, candidate_count);
     return 0;
@@ -581,6 +657,16 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  if (vm.count("resume") > 0 && boost::filesystem::exists(saveFileName)) {
+    std::ifstream previous { saveFileName };
+    const auto complete = completeRowsLength(previous);
+    previous.close();
+    if (static_cast<uintmax_t>(complete) < boost::filesystem::file_size(saveFileName)) {
+      std::cout << "dropping the partial last row of " << saveFileName << '\n';
+      boost::filesystem::resize_file(saveFileName, complete);
+    }
+  }
+
   std::ofstream output {};
   output.open(saveFileName, std::ios::app);
   output.seekp(0, std::ios::end);
@@ -588,6 +674,25 @@ int main(int argc, char* argv[])
     printErrorAndHelp("Output file " + parameterInputFile + " could not be read", all);
     return 1;
   }
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // Each job enumerates with its share of the cores.
+  const size_t enumerateThreads
+      = std::max<size_t>(1, std::thread::hardware_concurrency() / threads);
+
+  std::vector<Job<Dim>> jobs;
+  auto run = [&](const std::vector<size_t>& keyColumns) {
+    std::unordered_set<std::string> done;
+    if (vm.count("resume") > 0) {
+      std::ifstream previous { saveFileName };
+      done = readDoneKeys(previous, keyColumns);
+    }
+    runExperiment(jobs, done, output, threads,
+        [&g]() { return ExperimentWorker<Dim> { g.createDijkstra(), nullptr, nullptr }; });
+  };
+
   if (vm.count("enumerate") > 0) {
     if (output.tellp() == 0) {
       output << "type,from,to,maxRoutes,maxSimilarity,routeCount,ilpRecommendedRouteCount,"
@@ -598,25 +703,50 @@ int main(int argc, char* argv[])
     double maxSimilarity = 1.0;
 
     while (params >> maxRoutes >> maxSimilarity) {
-      std::cout << "Starting Configuration: " << maxRoutes << " " << maxSimilarity << "\n";
-
-      std::ifstream day { "daytour" };
-      std::ifstream week { "weektour" };
-      std::ifstream commute { "commute" };
-      enumerate(day, output, &g, maxRoutes, maxSimilarity, "day");
-      enumerate(week, output, &g, maxRoutes, maxSimilarity, "week");
-      enumerate(commute, output, &g, maxRoutes, maxSimilarity, "commute");
+      for (const auto& [fileName, type] : { std::pair { "daytour", "day" },
+               std::pair { "weektour", "week" }, std::pair { "commute", "commute" } }) {
+        for (const auto& pair : read_pairs(fileName, type)) {
+          jobs.push_back(Job<Dim> { csvKey(type, pair.from, pair.to, maxRoutes, maxSimilarity),
+              [&g, pair, maxRoutes, maxSimilarity, enumerateThreads](auto& worker) {
+                return enumerate(
+                    worker.d, &g, pair, maxRoutes, maxSimilarity, enumerateThreads);
+              } });
+        }
+      }
     }
+    run({ 0, 1, 2, 3, 4 });
   } else if (vm.count("all") > 0) {
     if (output.tellp() == 0) {
       output << "type,from,to,routeCount,time\n";
     }
-    std::ifstream day { "daytour" };
-    std::ifstream week { "weektour" };
-    std::ifstream commute { "commute" };
-    enumerate_all(commute, output, &g, "commute");
-    enumerate_all(day, output, &g, "day");
-    // enumerate_all(week, output, d, "week");
+    for (const auto& [fileName, type] :
+        { std::pair { "commute", "commute" }, std::pair { "daytour", "day" } }) {
+      for (const auto& pair : read_pairs(fileName, type)) {
+        jobs.push_back(Job<Dim> { csvKey(type, pair.from, pair.to),
+            [&g, pair, enumerateThreads](auto& worker) {
+              return enumerate_all(worker.d, &g, pair, enumerateThreads);
+            } });
+      }
+    }
+    run({ 0, 1, 2 });
+  } else if (vm.count("pareto") > 0) {
+    if (output.tellp() == 0) {
+      output << "type,from,to,paretoRouteCount,labelCount,paretoTime,routeCount,"
+                "routesOnFront,enumerationTime\n";
+    }
+    for (const auto& [fileName, type] :
+        { std::pair { "commute", "commute" }, std::pair { "daytour", "day" } }) {
+      for (const auto& pair : read_pairs(fileName, type)) {
+        jobs.push_back(Job<Dim> { csvKey(type, pair.from, pair.to),
+            [&g, pair, enumerateThreads](auto& worker) {
+              if (!worker.pareto) {
+                worker.pareto = std::make_unique<ParetoSearch<Dim>>(&g);
+              }
+              return compare_pareto(*worker.pareto, &g, pair, enumerateThreads);
+            } });
+      }
+    }
+    run({ 0, 1, 2 });
   } else if (vm.count("dijkstra") > 0) {
     if (output.tellp() == 0) {
       output << "from,to,";
@@ -625,40 +755,19 @@ int main(int argc, char* argv[])
       }
       output << "length,heigh_gain,unsuitabiltiy,edgeCount,pqPolls,time\n";
     }
-    auto grid = g.createGrid();
-    double lat_f, lng_f, lat_t, lng_t;
+    const auto& grid = g.getGrid();
     Config<Dim> conf = { { 1.0, 0.0, 0.0 } };
 
-    std::vector<std::pair<NodePos, NodePos>> st_pairs;
-    while (params >> lat_f >> lng_f >> lat_t >> lng_t) {
-      NodePos from = *grid.findNextNode(Lat { lat_f }, Lng { lng_f });
-      NodePos to = *grid.findNextNode(Lat { lat_t }, Lng { lng_t });
-      st_pairs.emplace_back(from, to);
-    }
-
-    for (auto& [from, to] : st_pairs) {
-
-      // Config conf = generateRandomConfig();
-      auto start = std::chrono::high_resolution_clock::now();
-      auto optRoute = d.findBestRoute(from, to, conf);
-      auto end = std::chrono::high_resolution_clock::now();
-      auto time = std::chrono::duration_cast<ms>(end - start).count();
-
-      if (!optRoute) {
-        std::cerr << "no route found between " << from << " and " << to << '\n';
+    for (const auto& pair : read_coordinate_pairs(params, grid)) {
+      if (!(pair.s && pair.t)) {
         continue;
       }
-      auto route = *optRoute;
-      output << from << "," << to << ",";
-      for (auto& val : conf.values) {
-        output << val << ",";
-      }
-      for (auto& cost : route.costs.values) {
-        output << cost << ",";
-      }
-      output << route.edges.size() << "," << d.pqPops << "," << time << '\n';
+      const NodePos from = *pair.s;
+      const NodePos to = *pair.t;
+      jobs.push_back(Job<Dim> { csvKey(from, to),
+          [from, to, conf](auto& worker) { return dijkstra_query(worker.d, from, to, conf); } });
     }
-
+    run({ 0, 1 });
   } else if (vm.count("random") > 0) {
     if (output.tellp() == 0) {
       output << "type,from,to,maxRoutes,maxSimilarity,routeCount,ilpRecommendedRouteCount,"
@@ -668,41 +777,84 @@ int main(int argc, char* argv[])
     size_t splitCount = 0;
     double maxSimilarity = 1.0;
     while (params >> splitCount >> maxSimilarity) {
-
-      std::cout << "Starting Configuration: " << splitCount << " " << maxSimilarity << "\n";
-
-      std::ifstream day { "daytour" };
-      std::ifstream week { "weektour" };
-      std::ifstream commute { "commute" };
-      explore_random(day, output, d, splitCount, maxSimilarity, "day");
-      explore_random(week, output, d, splitCount, maxSimilarity, "week");
-      explore_random(commute, output, d, splitCount, maxSimilarity, "commute");
+      for (const auto& [fileName, type] : { std::pair { "daytour", "day" },
+               std::pair { "weektour", "week" }, std::pair { "commute", "commute" } }) {
+        for (const auto& pair : read_pairs(fileName, type)) {
+          jobs.push_back(
+              Job<Dim> { csvKey(type, pair.from, pair.to, splitCount * 3, maxSimilarity),
+                  [pair, splitCount, maxSimilarity](auto& worker) {
+                    return explore_random(worker.d, pair, splitCount, maxSimilarity);
+                  } });
+        }
+      }
     }
+    run({ 0, 1, 2, 3, 4 });
   } else if (vm.count("naive") > 0) {
     if (output.tellp() == 0) {
-      output << "type,from,to,maxRoutes,maxSimilarity,routeCount,ilpRecommendedRouteCount,"
+      output << "type,from,to,epsilon,maxSimilarity,routeCount,ilpRecommendedRouteCount,"
                 "greedyRecommendedRouteCount,exploreTime,ilpRecommendationTime,"
                 "greedyRecommendationTime\n";
     }
 
     for (double epsilon, maxSimilarity; params >> epsilon >> maxSimilarity;) {
-      std::cout << "running config: " << epsilon << " " << maxSimilarity << '\n';
-
-      std::ifstream day { "daytour" };
-      std::ifstream week { "weektour" };
-      std::ifstream commute { "commute" };
-      explore_naive(commute, output, d, epsilon, maxSimilarity, "commute");
-      explore_naive(day, output, d, epsilon, maxSimilarity, "day");
-      explore_naive(week, output, d, epsilon, maxSimilarity, "week");
+      for (const auto& [fileName, type] : { std::pair { "commute", "commute" },
+               std::pair { "daytour", "day" }, std::pair { "weektour", "week" } }) {
+        for (const auto& pair : read_pairs(fileName, type)) {
+          jobs.push_back(Job<Dim> { csvKey(type, pair.from, pair.to, epsilon, maxSimilarity),
+              [pair, epsilon, maxSimilarity](auto& worker) {
+                return explore_naive(worker.d, pair, epsilon, maxSimilarity);
+              } });
+        }
+      }
     }
+    run({ 0, 1, 2, 3, 4 });
   } else if (vm.count("st") > 0) {
-    Grid grid = g.createGrid();
-    explore_s_t_pairs(params, output, grid, &g, loadFileName);
+    if (output.tellp() == 0) {
+      output << "s_lat,s_lng,t_lat,t_lng,inputgraph,starttime,R,K,time,#routes,min_similarity,"
+                "max_similarity,avg_similarity\n";
+    }
+    auto graph_file_name = boost::filesystem::path(loadFileName).filename();
+    auto now = c::system_clock::to_time_t(c::system_clock::now());
+    auto starttime = std::localtime(&now);
+
+    const size_t refinements = 40;
+    const double max_similarity = 0.5;
+    for (const auto& pair : read_snapped_pairs(params, g.getGrid())) {
+      auto [prefix, key] = coordinate_prefix(pair, graph_file_name, starttime);
+      jobs.push_back(Job<Dim> { key,
+          [&g, pair, prefix = prefix, refinements, max_similarity, enumerateThreads](
+              auto& worker) {
+            if (!worker.enumerate) {
+              worker.enumerate = std::make_unique<EnumerateOptimals<Dim, SimilarityPrio>>(
+                  &g, refinements, enumerateThreads);
+              worker.enumerate->set_overlap(max_similarity);
+            }
+            return explore_s_t_pairs(
+                *worker.enumerate, pair, prefix, refinements, max_similarity);
+          } });
+    }
+    run({ 0, 1, 2, 3, 4 });
   } else if (vm.count("restricted") > 0) {
-    Grid grid = g.createGrid();
-    restricted_exploration(params, output, grid, &g, loadFileName, restriction_parameter);
+    if (output.tellp() == 0) {
+      output << "s_lat,s_lng,t_lat,t_lng,inputgraph,starttime,restriction_parameters,all_time,"
+                "#all_routes,all_avg_load,all_max_load,restr_time,#restr_routes,restr_avg_load,"
+                "restr_max_load\n";
+    }
+    auto graph_file_name = boost::filesystem::path(loadFileName).filename();
+    auto now = c::system_clock::to_time_t(c::system_clock::now());
+    auto starttime = std::localtime(&now);
+
+    for (const auto& pair : read_snapped_pairs(params, g.getGrid())) {
+      auto [prefix, key] = coordinate_prefix(pair, graph_file_name, starttime);
+      jobs.push_back(Job<Dim> { key + ",\"" + restriction_parameter + '"',
+          [&g, pair, prefix = prefix, &restriction_parameter, enumerateThreads](auto&) {
+            return restricted_exploration(
+                &g, pair, prefix, restriction_parameter, enumerateThreads);
+          } });
+    }
+    run({ 0, 1, 2, 3, 4, 6 });
   } else if (vm.count("load") > 0) {
-    Grid grid = g.createGrid();
+    const Grid& grid = g.getGrid();
     load_histogramm(g, grid);
   }
   return 0;
@@ -16,13 +16,17 @@
   along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include "alt.hpp"
+#include "compute_executor.hpp"
 #include "dijkstra.hpp"
 #include "enumerate_optimals.hpp"
 #include "graph_loading.hpp"
 #include "grid.hpp"
-#include "loginfo.hpp"
+#include "metrics.hpp"
 #include "ndijkstra.hpp"
 #include "routeComparator.hpp"
+#include "segment_index.hpp"
+#include "static_assets.hpp"
 #include "url_parsing.hpp"
 #include "webUtilities.hpp"
 
@@ -30,11 +34,14 @@
 #include "json/json.h"
 
 #include <boost/archive/binary_oarchive.hpp>
-#include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include <chrono>
+#include <condition_variable>
 #include <fstream>
+#include <functional>
 #include <random>
+#include <sstream>
+#include <thread>
 
 template <> double Cost<1>::operator*(const ConfigD&) const{
   return values[0];
@@ -49,7 +56,127 @@ template <int Dim> void saveToBinaryFile(Graph<Dim>& ch, std::string& filename)
   }
 }
 
-template <int Dim> void runWebServer(Graph<Dim>& g, unsigned short port, size_t max_refinements)
+struct ServerOptions {
+  unsigned short port;
+  size_t max_refinements;
+  size_t io_threads;
+  size_t compute_threads;
+  size_t queue_depth;
+  size_t max_route_jobs;
+  size_t max_enumerate_jobs;
+  size_t max_batch_jobs;
+  size_t watch_seconds;
+  bool admin_reload;
+};
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct EndpointMetrics {
+  Counter& requests;
+  Counter& rejected;
+  Histogram& queueWait;
+  Histogram& latency;
+
+  EndpointMetrics(MetricsRegistry& registry, const std::string& endpoint)
+      : requests(registry.counter(
+          "cyclops_requests_total", "Received requests", { { "endpoint", endpoint } }))
+      , rejected(registry.counter("cyclops_rejected_requests_total",
+            "Requests rejected because the server was busy", { { "endpoint", endpoint } }))
+      , queueWait(registry.histogram("cyclops_queue_wait_seconds",
+            "Time accepted requests waited for a compute worker", { { "endpoint", endpoint } },
+            1e-6))
+      , latency(registry.histogram("cyclops_request_duration_seconds",
+            "Time from receiving to answering accepted requests", { { "endpoint", endpoint } },
+            1e-6))
+  {
+  }
+};
+
+struct QueryMetrics {
+  Histogram& pqPops;
+  Histogram& settledNodes;
+  Histogram& relaxedEdges;
+  Histogram& unpackTime;
+
+  QueryMetrics(MetricsRegistry& registry)
+      : pqPops(registry.histogram("cyclops_dijkstra_pq_pops", "PQ pops per CH query"))
+      , settledNodes(
+            registry.histogram("cyclops_dijkstra_settled_nodes", "Settled nodes per CH query"))
+      , relaxedEdges(
+            registry.histogram("cyclops_dijkstra_relaxed_edges", "Relaxed edges per CH query"))
+      , unpackTime(registry.histogram("cyclops_dijkstra_unpack_seconds",
+            "Time to unpack the shortcuts of a found route", {}, 1e-6))
+  {
+  }
+
+  template <int Dim> void record(const Dijkstra<Dim>& d)
+  {
+    pqPops.record(d.pqPops);
+    settledNodes.record(d.settledNodes);
+    relaxedEdges.record(d.relaxedEdges);
+    unpackTime.record(d.unpackTime);
+  }
+};
+
+struct EnumerationMetrics {
+  Histogram& dijkstraCount;
+  Histogram& enumerationTime;
+  Histogram& triangulationTime;
+  Histogram& recommendationTime;
+
+  EnumerationMetrics(MetricsRegistry& registry)
+      : dijkstraCount(registry.histogram(
+          "cyclops_enumerate_dijkstra_queries", "Dijkstra queries per enumeration"))
+      , enumerationTime(registry.histogram("cyclops_enumerate_enumeration_seconds",
+            "Time to enumerate all routes", {}, 1e-3))
+      , triangulationTime(registry.histogram("cyclops_enumerate_triangulation_seconds",
+            "Time spent maintaining the triangulation during enumeration", {}, 1e-6))
+      , recommendationTime(registry.histogram("cyclops_enumerate_recommendation_seconds",
+            "Time to select the recommended routes", {}, 1e-3))
+  {
+  }
+
+  template <class Enumeration> void record(const Enumeration& e)
+  {
+    dijkstraCount.record(e.dijkstra_count);
+    enumerationTime.record(e.enumeration_time);
+    triangulationTime.record(e.triangulation_time);
+    recommendationTime.record(e.recommendation_time);
+  }
+};
+
+// Everything requests are answered from. Requests keep the snapshot they
+// started with, so a reloaded graph replaces it without waiting for them and
+// the old graph is freed when the last of them finishes.
+template <int Dim> struct GraphSnapshot {
+  GraphSnapshot(Graph<Dim>&& graph, size_t computeThreads)
+      : graph(std::move(graph))
+  {
+    // Build the indices before the snapshot serves requests.
+    this->graph.getGrid();
+    this->graph.getSegmentIndex();
+    dijkstras.reserve(computeThreads);
+    for (size_t i = 0; i < computeThreads; ++i) {
+      dijkstras.push_back(this->graph.createDijkstra());
+    }
+  }
+
+  Graph<Dim> graph;
+  // One per compute worker.
+  std::vector<Dijkstra<Dim>> dijkstras;
+};
+
+template <class Response> void rejectBusy(Response& response)
+{
+  SimpleWeb::CaseInsensitiveMultimap header;
+  header.emplace("Retry-After", "1");
+  response->write(SimpleWeb::StatusCode::server_error_service_unavailable,
+      "Server is busy, try again later", header);
+}
+
+template <int Dim>
+void runWebServer(Graph<Dim>&& g, std::function<Graph<Dim>()> loadGraph,
+    const std::string& graphFile, const ServerOptions& options)
 {
   using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
   using Response = std::shared_ptr<HttpServer::Response>;
@@ -57,13 +184,85 @@ template <int Dim> void runWebServer(Graph<Dim>& g, unsigned short port, size_t
 
   using Dijkstra = Dijkstra<Dim>;
   using Config = Config<Dim>;
-
-  Grid grid = g.createGrid();
+  using Snapshot = GraphSnapshot<Dim>;
+
+  StaticAssets assets { "web" };
+  std::cout << "Serving " << assets.size() << " static files from memory" << '\n';
+
+  // Route computations run on their own workers so that the I/O threads only
+  // parse requests and write responses. Every worker keeps its own Dijkstra in
+  // the snapshot, jobs hold on to the snapshot they were submitted with.
+  const size_t computeThreads = std::max<size_t>(1, options.compute_threads);
+  std::shared_ptr<Snapshot> current = std::make_shared<Snapshot>(std::move(g), computeThreads);
+  AdmissionLimit routeLimit { options.max_route_jobs };
+  AdmissionLimit enumerateLimit { options.max_enumerate_jobs };
+  AdmissionLimit batchLimit { options.max_batch_jobs };
+
+  MetricsRegistry metrics;
+  EndpointMetrics nodeAtMetrics { metrics, "/node_at" };
+  EndpointMetrics nodeAtBatchMetrics { metrics, "/node_at/batch" };
+  EndpointMetrics routeMetrics { metrics, "/route" };
+  EndpointMetrics batchMetrics { metrics, "/route/batch" };
+  EndpointMetrics enumerateMetrics { metrics, "/enumerate" };
+  QueryMetrics queryMetrics { metrics };
+  EnumerationMetrics enumerationMetrics { metrics };
+  // Each enumeration starts its own Dijkstra threads, share the cores between them.
+  const size_t enumerateThreads
+      = std::max<size_t>(1, computeThreads / std::max<size_t>(1, options.max_enumerate_jobs));
+  const size_t snapThreads
+      = std::max<size_t>(1, computeThreads / std::max<size_t>(1, options.max_batch_jobs));
+  ComputeExecutor executor { computeThreads, options.queue_depth };
+
+  metrics.gauge("cyclops_compute_queue_depth", "Requests waiting for a compute worker",
+      [&executor]() { return executor.queue_depth(); });
+  metrics.gauge("cyclops_compute_workers", "Threads computing routes",
+      [&executor]() { return executor.worker_count(); });
+  metrics.gauge("cyclops_jobs_in_flight", "Queued or running requests",
+      [&routeLimit]() { return routeLimit.in_use(); }, { { "endpoint", "/route" } });
+  metrics.gauge("cyclops_jobs_in_flight", "Queued or running requests",
+      [&batchLimit]() { return batchLimit.in_use(); }, { { "endpoint", "/route/batch" } });
+  metrics.gauge("cyclops_jobs_in_flight", "Queued or running requests",
+      [&enumerateLimit]() { return enumerateLimit.in_use(); }, { { "endpoint", "/enumerate" } });
+  metrics.gauge("cyclops_graph_nodes", "Nodes of the served graph",
+      [&current]() { return std::atomic_load(&current)->graph.getNodeCount(); });
+  Counter& reloads = metrics.counter(
+      "cyclops_graph_reloads_total", "Graph reloads", { { "result", "success" } });
+  Counter& failedReloads = metrics.counter(
+      "cyclops_graph_reloads_total", "Graph reloads", { { "result", "failure" } });
+
+  // Reloads run one at a time next to the server, which answers from the
+  // current snapshot until the new one is swapped in.
+  std::atomic<bool> reloading { false };
+  std::mutex reloadMutex;
+  std::thread reloadThread;
+  auto reload = [&]() {
+    if (reloading.exchange(true)) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock { reloadMutex };
+    if (reloadThread.joinable()) {
+      reloadThread.join();
+    }
+    reloadThread = std::thread([&]() {
+      try {
+        auto start = Clock::now();
+        auto next = std::make_shared<Snapshot>(loadGraph(), computeThreads);
+        std::atomic_store(&current, next);
+        reloads.add();
+        std::cout << "Reloaded " << graphFile << " in " << micros_since(start) / 1000 << "ms"
+                  << '\n';
+      } catch (std::exception& e) {
+        failedReloads.add();
+        std::cerr << "Reloading " << graphFile << " failed: " << e.what() << '\n';
+      }
+      reloading = false;
+    });
+    return true;
+  };
 
   HttpServer server;
-  server.config.port = port;
-  server.config.thread_pool_size
-      = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+  server.config.port = options.port;
+  server.config.thread_pool_size = std::max<size_t>(1, options.io_threads);
 
   server.default_resource["GET"] = [](Response response, Request /*request*/) {
     SimpleWeb::CaseInsensitiveMultimap header;
@@ -72,42 +271,47 @@ template <int Dim> void runWebServer(Graph<Dim>& g, unsigned short port, size_t
         SimpleWeb::StatusCode::redirection_temporary_redirect, "No matching handler found", header);
   };
 
-  server.resource["^/web/?.*"]["GET"] = [](Response response, Request request) {
-    Logger::initLogger();
-    auto web_root_path = boost::filesystem::canonical("web");
-
+  server.resource["^/web/?.*"]["GET"] = [&assets](Response response, Request request) {
     std::string pathWithoutWeb {};
     if (request->path.length() > 4) {
       pathWithoutWeb = request->path.substr(4);
     }
 
-    auto path = boost::filesystem::canonical(web_root_path / pathWithoutWeb);
-    // Check if path is within web_root_path
-    if (std::distance(web_root_path.begin(), web_root_path.end())
-            > std::distance(path.begin(), path.end())
-        || !std::equal(web_root_path.begin(), web_root_path.end(), path.begin())) {
-      throw std::invalid_argument("path must be within root path");
-    }
-    if (boost::filesystem::is_directory(path)) {
-      path /= "index.html";
+    const auto asset = assets.find(pathWithoutWeb);
+    if (!asset) {
+      response->write(SimpleWeb::StatusCode::client_error_not_found, "No such file");
+      return;
     }
 
-    std::ifstream ifs {};
-    ifs.open(path.string(), std::ifstream::in | std::ios::binary | std::ios::ate);
+    auto acceptEncoding = request->header.find("Accept-Encoding");
+    const bool gzipped = !asset->gzipBody.empty() && acceptEncoding != request->header.end()
+        && accepts_gzip(acceptEncoding->second);
+    const auto& etag = gzipped ? asset->gzipEtag : asset->etag;
 
-    if (!ifs) {
-      response->write(SimpleWeb::StatusCode::client_error_not_found, "No such file");
+    SimpleWeb::CaseInsensitiveMultimap header;
+    header.emplace("ETag", etag);
+    header.emplace("Cache-Control", "no-cache");
+    header.emplace("Vary", "Accept-Encoding");
+
+    auto ifNoneMatch = request->header.find("If-None-Match");
+    if (ifNoneMatch != request->header.end() && etag_matches(ifNoneMatch->second, etag)) {
+      response->write(SimpleWeb::StatusCode::redirection_not_modified, header);
+      return;
     }
-    auto length = ifs.tellg();
-    ifs.seekg(0, std::ios::beg);
 
-    std::string buffer(length, '\0');
-    ifs.read(&buffer[0], length);
-    response->write(buffer);
+    header.emplace("Content-Type", asset->contentType);
+    if (gzipped) {
+      header.emplace("Content-Encoding", "gzip");
+      response->write(SimpleWeb::StatusCode::success_ok, asset->gzipBody, header);
+      return;
+    }
+    response->write(SimpleWeb::StatusCode::success_ok, asset->body, header);
   };
 
-  server.resource["^/node_at"]["GET"] = [&grid](Response response, Request request) {
-    Logger::initLogger();
+  server.resource["^/node_at"]["GET"] = [&current, &nodeAtMetrics](
+                                             Response response, Request request) {
+    auto requestStart = Clock::now();
+    nodeAtMetrics.requests.add();
     const double IMPOSSIBLE_VALUE = -1000;
     double lat = IMPOSSIBLE_VALUE;
     double lng = IMPOSSIBLE_VALUE;
@@ -125,14 +329,69 @@ template <int Dim> void runWebServer(Graph<Dim>& g, unsigned short port, size_t
           "Request needs to contain lat and lng parameters for query");
       return;
     }
-    auto pos = grid.findNextNode(Lat { lat }, Lng { lng });
+    auto snapshot = std::atomic_load(&current);
+    auto pos = snapshot->graph.getGrid().findNextNode(Lat { lat }, Lng { lng });
     SimpleWeb::CaseInsensitiveMultimap header;
     header.emplace("Content-Type", "text/plain");
     response->write(SimpleWeb::StatusCode::success_ok, std::to_string(pos->get()), header);
+    nodeAtMetrics.latency.record(micros_since(requestStart));
   };
 
-  server.resource["^/graph_coords"]["GET"] = [&grid](Response response, Request /*request*/) {
-    auto b_box = grid.bounding_box();
+  server.resource["^/node_at/batch$"]["POST"]
+      = [&current, &executor, &batchLimit, &nodeAtBatchMetrics, snapThreads](
+            Response response, Request request) {
+          auto requestStart = Clock::now();
+          nodeAtBatchMetrics.requests.add();
+
+          std::vector<LatLng> coordinates;
+          try {
+            Json::Value body;
+            Json::CharReaderBuilder builder;
+            std::string errors;
+            std::istringstream content { request->content.string() };
+            if (!Json::parseFromStream(builder, content, &body, &errors)) {
+              response->write(SimpleWeb::StatusCode::client_error_bad_request,
+                  "Request body is not valid JSON: " + errors);
+              return;
+            }
+            coordinates = parseCoordinates(body);
+          } catch (std::exception& e) {
+            response->write(SimpleWeb::StatusCode::client_error_bad_request, e.what());
+            return;
+          }
+
+          // Snapping shares the batch limit with /route/batch, large requests start
+          // their own threads.
+          auto submitted = executor.try_submit(batchLimit,
+              [snapshot = std::atomic_load(&current), &nodeAtBatchMetrics, snapThreads, response,
+                  coordinates = std::move(coordinates), requestStart](size_t /*worker*/) {
+                nodeAtBatchMetrics.queueWait.record(micros_since(requestStart));
+                try {
+                  const auto& grid = snapshot->graph.getGrid();
+                  Json::Value result(Json::arrayValue);
+                  for (const auto& pos : grid.findNextNodes(coordinates, snapThreads)) {
+                    result.append(pos ? Json::Value { pos->get() } : Json::Value {});
+                  }
+
+                  SimpleWeb::CaseInsensitiveMultimap header;
+                  header.emplace("Content-Type", "application/json");
+                  Json::StreamWriterBuilder builder;
+                  response->write(SimpleWeb::StatusCode::success_ok,
+                      Json::writeString(builder, result), header);
+                } catch (std::exception& e) {
+                  response->write(
+                      SimpleWeb::StatusCode::server_error_internal_server_error, e.what());
+                }
+                nodeAtBatchMetrics.latency.record(micros_since(requestStart));
+              });
+          if (!submitted) {
+            nodeAtBatchMetrics.rejected.add();
+            rejectBusy(response);
+          }
+        };
+
+  server.resource["^/graph_coords"]["GET"] = [&current](Response response, Request /*request*/) {
+    auto b_box = std::atomic_load(&current)->graph.getGrid().bounding_box();
 
     Json::Value result;
     result["lat_min"] = b_box.lat_min.get();
@@ -147,62 +406,207 @@ template <int Dim> void runWebServer(Graph<Dim>& g, unsigned short port, size_t
     response->write(SimpleWeb::StatusCode::success_ok, Json::writeString(builder, result), header);
   };
 
-  server.resource["^/route"]["GET"] = [&g](Response response, Request request) {
-    auto log = Logger::initLogger();
-
-    std::optional<uint32_t> s {}, t {}, length {}, height {}, unsuitability {};
-    extractQueryFields(request->parse_query_string(), s, t, length, height, unsuitability);
-    if (s > g.getNodeCount() || t > g.getNodeCount()) {
-      response->write(
-          SimpleWeb::StatusCode::client_error_bad_request, "Request contains illegal node ids");
-      return;
-    }
+  server.resource["^/route"]["GET"]
+      = [&current, &executor, &routeLimit, &routeMetrics, &queryMetrics](
+            Response response, Request request) {
+          auto requestStart = Clock::now();
+          routeMetrics.requests.add();
+          auto snapshot = std::atomic_load(&current);
+          const auto& g = snapshot->graph;
 
-    if (!(s && t && length && height && unsuitability)) {
-      response->write(SimpleWeb::StatusCode::client_error_bad_request,
-          "Request needs to contain the parameters: s, t, length, height, unsuitability");
-      return;
-    }
+          std::optional<uint32_t> s {}, t {}, length {}, height {}, unsuitability {};
+          auto queryParams = request->parse_query_string();
+          extractQueryFields(queryParams, s, t, length, height, unsuitability);
+          if (s > g.getNodeCount() || t > g.getNodeCount()) {
+            response->write(SimpleWeb::StatusCode::client_error_bad_request,
+                "Request contains illegal node ids");
+            return;
+          }
+          // Coordinates are snapped onto the closest road instead of the closest node.
+          auto sCoord = extractCoordinate(queryParams, "s");
+          auto tCoord = extractCoordinate(queryParams, "t");
+          const bool snap = sCoord && tCoord;
 
-    try {
-      auto dijkstra = g.createDijkstra();
+          if (!((s && t) || snap) || !(length && height && unsuitability)) {
+            response->write(SimpleWeb::StatusCode::client_error_bad_request,
+                "Request needs to contain the parameters: s, t (or s_lat, s_lng, t_lat, t_lng), "
+                "length, height, unsuitability");
+            return;
+          }
 
-      typename Dijkstra::ScalingFactor f;
-      dijkstra.calcScalingFactor(NodePos { *s }, NodePos { *t }, f);
+          Config c { LengthConfig { (static_cast<double>(*length) / 100.0) },
+            HeightConfig { (static_cast<double>(*height) / 100.0) },
+            UnsuitabilityConfig { (static_cast<double>(*unsuitability) / 100.0) } };
+
+          auto submitted = executor.try_submit(routeLimit,
+              [snapshot, &routeMetrics, &queryMetrics, response, queryParams, s, t, sCoord,
+                  tCoord, snap, c, requestStart](size_t worker) {
+                auto traceMark = Trace::mark();
+                auto waited = micros_since(requestStart);
+                routeMetrics.queueWait.record(waited);
+                Trace::event("dequeued", { TraceField { "waited_us", waited } });
+                try {
+                  const auto& g = snapshot->graph;
+                  const auto& segmentIndex = g.getSegmentIndex();
+                  auto& dijkstra = snapshot->dijkstras[worker];
+
+                  std::optional<Route<Dim>> route;
+                  std::optional<LatLng> start, end;
+                  if (snap) {
+                    TraceSpan span { "snap" };
+                    auto from = segmentIndex.findNextSegment(sCoord->lat, sCoord->lng);
+                    auto to = segmentIndex.findNextSegment(tCoord->lat, tCoord->lng);
+                    span.end();
+                    if (from && to) {
+                      start = from->point;
+                      end = to->point;
+                      route = dijkstra.findBestRoute(*from, *to, c);
+                    }
+                  } else {
+                    route = dijkstra.findBestRoute(NodePos { *s }, NodePos { *t }, c);
+                  }
+                  queryMetrics.record(dijkstra);
+
+                  if (!route) {
+                    response->write(
+                        SimpleWeb::StatusCode::client_error_not_found, "Did not find route");
+                  } else {
+                    auto tolerance = extractSimplificationTolerance(queryParams, *route, g);
+                    auto json = [&]() {
+                      TraceSpan span { "to_json" };
+                      return routeToJson(*route, g, tolerance, start, end);
+                    }();
+                    addTraceToJson(json, traceMark, queryParams);
+                    SimpleWeb::CaseInsensitiveMultimap header;
+                    header.emplace("Content-Type", "application/json");
+
+                    Json::StreamWriterBuilder builder;
+                    response->write(SimpleWeb::StatusCode::success_ok,
+                        Json::writeString(builder, json), header);
+                  }
+                } catch (std::exception& e) {
+                  response->write(
+                      SimpleWeb::StatusCode::server_error_internal_server_error, e.what());
+                }
+                routeMetrics.latency.record(micros_since(requestStart));
+              });
+          if (!submitted) {
+            routeMetrics.rejected.add();
+            rejectBusy(response);
+          }
+        };
 
-      Config c { LengthConfig { (static_cast<double>(*length) / 100.0) },
-        HeightConfig { (static_cast<double>(*height) / 100.0) },
-        UnsuitabilityConfig { (static_cast<double>(*unsuitability) / 100.0) } };
+  server.resource["^/route/batch$"]["POST"] = [&current, &executor, &batchLimit, &batchMetrics,
+                                                  &queryMetrics,
+                                                  maxBatchJobs = options.max_batch_jobs](
+                                                  Response response, Request request) {
+    auto requestStart = Clock::now();
+    batchMetrics.requests.add();
+    auto snapshot = std::atomic_load(&current);
 
-      for (size_t i = 0; i < Dim; ++i) { }
+    std::vector<BatchQuery<Dim>> queries;
+    try {
+      Json::Value body;
+      Json::CharReaderBuilder builder;
+      std::string errors;
+      std::istringstream content { request->content.string() };
+      if (!Json::parseFromStream(builder, content, &body, &errors)) {
+        response->write(SimpleWeb::StatusCode::client_error_bad_request,
+            "Request body is not valid JSON: " + errors);
+        return;
+      }
+      queries = parseBatchQueries<Dim>(body, snapshot->graph.getNodeCount());
+    } catch (std::exception& e) {
+      response->write(SimpleWeb::StatusCode::client_error_bad_request, e.what());
+      return;
+    }
 
-      auto start = std::chrono::high_resolution_clock::now();
-      auto route = dijkstra.findBestRoute(NodePos { *s }, NodePos { *t }, c);
-      auto end = std::chrono::high_resolution_clock::now();
-      size_t dur = std::chrono::duration_cast<ms>(end - start).count();
-      *log << "Dijkstra took " << dur << "ms"
-           << "\n \n";
+    auto queryParams = request->parse_query_string();
+    bool withGeometry = true;
+    for (const auto& param : queryParams) {
+      if (param.first == "geometry") {
+        withGeometry = param.second != "false" && param.second != "0";
+      }
+    }
 
-      std::cout << "Finding the route took " << dur << "ms" << '\n';
-      if (route) {
+    SimpleWeb::CaseInsensitiveMultimap header;
+    header.emplace("Content-Type", "application/json");
+    if (queries.empty()) {
+      response->write(SimpleWeb::StatusCode::success_ok, "[]", header);
+      return;
+    }
+    if (!batchLimit.try_acquire()) {
+      batchMetrics.rejected.add();
+      rejectBusy(response);
+      return;
+    }
 
-        auto json = routeToJson(*route, g, true);
-        SimpleWeb::CaseInsensitiveMultimap header;
-        header.emplace("Content-Type", "application/json");
+    // Every helper works off the same batch, so a busy executor running only
+    // one of them still answers the whole request. Batches only get a share of
+    // the workers to keep /route and /enumerate answering meanwhile.
+    auto batch = std::make_shared<RouteBatch<Dim>>(std::move(queries));
+    auto helpers = batch_helpers(batch->size(), executor.worker_count(), maxBatchJobs);
+    size_t submitted = 0;
+    for (size_t i = 0; i < helpers; ++i) {
+      auto accepted = executor.try_submit([snapshot, &batchLimit, &batchMetrics, &queryMetrics,
+                                              batch, response, queryParams, withGeometry, header,
+                                              requestStart](size_t worker) {
+        batchMetrics.queueWait.record(micros_since(requestStart));
+        const auto& g = snapshot->graph;
+        auto recordQuery = [&queryMetrics](const Dijkstra& d) { queryMetrics.record(d); };
+        if (!batch->work(snapshot->dijkstras[worker], g.getGrid(), recordQuery)) {
+          return;
+        }
+        batchLimit.release();
+
+        try {
+          Json::Value result(Json::arrayValue);
+          for (const auto& entry : batch->get_results()) {
+            if (!entry.route) {
+              Json::Value error;
+              error["error"] = entry.error;
+              result.append(error);
+            } else if (withGeometry) {
+              auto tolerance = extractSimplificationTolerance(queryParams, *entry.route, g);
+              result.append(routeToJson(*entry.route, g, tolerance));
+            } else {
+              Json::Value costs(Json::arrayValue);
+              for (const auto& v : entry.route->costs.values) {
+                costs.append(v);
+              }
+              Json::Value route;
+              route["costs"] = costs;
+              result.append(route);
+            }
+          }
 
-        Json::StreamWriterBuilder builder;
-        response->write(
-            SimpleWeb::StatusCode::success_ok, Json::writeString(builder, json), header);
+          Json::StreamWriterBuilder builder;
+          response->write(
+              SimpleWeb::StatusCode::success_ok, Json::writeString(builder, result), header);
+        } catch (std::exception& e) {
+          response->write(SimpleWeb::StatusCode::server_error_internal_server_error, e.what());
+        }
+        batchMetrics.latency.record(micros_since(requestStart));
+      });
+      if (!accepted) {
+        break;
       }
-      response->write(SimpleWeb::StatusCode::client_error_not_found, "Did not find route");
-    } catch (std::exception& e) {
-      response->write(SimpleWeb::StatusCode::server_error_internal_server_error, e.what());
+      ++submitted;
+    }
+    if (submitted == 0) {
+      batchLimit.release();
+      batchMetrics.rejected.add();
+      rejectBusy(response);
     }
   };
 
   server.resource["^/enumerate"]["GET"]
-      = [&g, max_refinements](Response response, Request request) {
-          auto log = Logger::initLogger();
+      = [&current, &executor, &enumerateLimit, &enumerateMetrics, &enumerationMetrics,
+            enumerateThreads,
+            max_refinements = options.max_refinements](Response response, Request request) {
+          auto requestStart = Clock::now();
+          enumerateMetrics.requests.add();
+          auto snapshot = std::atomic_load(&current);
 
           std::optional<uint32_t> s {}, t {}, dummy {}, maxOverlap {}, maxRoutes {};
           std::vector<ImportantMetric> important_metrics;
@@ -223,7 +627,8 @@ template <int Dim> void runWebServer(Graph<Dim>& g, unsigned short port, size_t
               }
             }
           }
-          if (s > g.getNodeCount() || t > g.getNodeCount()) {
+          const auto nodeCount = snapshot->graph.getNodeCount();
+          if (s > nodeCount || t > nodeCount) {
             response->write(SimpleWeb::StatusCode::client_error_bad_request,
                 "Request contains illegal node ids");
             return;
@@ -233,87 +638,170 @@ template <int Dim> void runWebServer(Graph<Dim>& g, unsigned short port, size_t
                 "Request needs to contain the parameters: s, t, maxOverlap, maxRoutes");
             return;
           }
-          uint32_t log_s = *s;
-          uint32_t log_t = *t;
-          *log << "enumerating routes from " << log_s << " to " << log_t << "\n";
-
-          if (*maxRoutes > max_refinements) {
-            size_t log_max_routes = *maxRoutes;
-            *log << "reduced max refinements from " << log_max_routes << " to " << max_refinements
-                 << " because of server options."
-                 << "\n";
-            maxRoutes = max_refinements;
+          auto submitted = executor.try_submit(enumerateLimit,
+              [snapshot, &enumerateMetrics, &enumerationMetrics, enumerateThreads,
+                  max_refinements, response, queryParams, important_metrics, requestStart,
+                  from = NodePos { *s }, to = NodePos { *t }, maxOverlap = *maxOverlap,
+                  maxRoutes = *maxRoutes](size_t /*worker*/) mutable {
+                auto traceMark = Trace::mark();
+                auto waited = micros_since(requestStart);
+                enumerateMetrics.queueWait.record(waited);
+                Trace::event("dequeued",
+                    { TraceField { "waited_us", waited }, TraceField { "s", from.get() },
+                        TraceField { "t", to.get() } });
+
+                if (maxRoutes > max_refinements) {
+                  Trace::event("reduced_max_refinements",
+                      { TraceField { "requested", maxRoutes },
+                          TraceField { "allowed", max_refinements } });
+                  maxRoutes = max_refinements;
+                }
+
+                auto overlap = maxOverlap / 100.0;
+                auto& g = snapshot->graph;
+                try {
+                  auto [routes, configs] = [&]() {
+                    if (important_metrics.empty()) {
+
+                      EnumerateOptimals<Dim, SimilarityPrio> enumerate(
+                          &g, maxRoutes, enumerateThreads);
+                      enumerate.set_overlap(overlap);
+
+                      enumerate.find(from, to);
+                      auto recommended = enumerate.recommend_routes(false);
+                      enumerationMetrics.record(enumerate);
+                      return recommended;
+                    } else {
+
+                      auto slacks = important_metrics_to_array<Dim>(important_metrics);
+
+                      EnumerateOptimals<Dim, SimilarityPrioExcludeIrrelevant> enumerate(
+                          &g, maxRoutes, enumerateThreads);
+                      enumerate.set_overlap(overlap);
+                      enumerate.set_slack(slacks);
+
+                      enumerate.find(from, to);
+                      auto recommended = enumerate.recommend_routes(false);
+                      enumerationMetrics.record(enumerate);
+                      return recommended;
+                    }
+                  }();
+
+                  Json::Value result;
+                  Json::Value points(Json::arrayValue);
+
+                  for (size_t i = 0; i < routes.size(); ++i) {
+
+                    Json::Value route;
+                    Json::Value conf(Json::arrayValue);
+
+                    for (const auto& v : configs[i].values) {
+                      conf.append(v);
+                    }
+                    route["conf"] = conf;
+
+                    auto tolerance = extractSimplificationTolerance(queryParams, routes[i], g);
+                    route["route"] = routeToJson(routes[i], g, tolerance);
+                    route["selected"] = true;
+
+                    points.append(route);
+                  }
+
+                  result["points"] = points;
+                  addTraceToJson(result, traceMark, queryParams);
+
+                  SimpleWeb::CaseInsensitiveMultimap header;
+                  header.emplace("Content-Type", "application/json");
+
+                  Json::StreamWriterBuilder builder;
+
+                  response->write(SimpleWeb::StatusCode::success_ok,
+                      Json::writeString(builder, result), header);
+                } catch (std::exception& e) {
+                  response->write(
+                      SimpleWeb::StatusCode::server_error_internal_server_error, e.what());
+                }
+                enumerateMetrics.latency.record(micros_since(requestStart));
+              });
+          if (!submitted) {
+            enumerateMetrics.rejected.add();
+            rejectBusy(response);
           }
+        };
 
-          auto overlap = *maxOverlap / 100.0;
-          auto [routes, configs] = [&]() {
-            if (important_metrics.empty()) {
-
-              EnumerateOptimals<Dim, SimilarityPrio> enumerate(&g, *maxRoutes);
-              enumerate.set_overlap(overlap);
-
-              enumerate.find(NodePos { *s }, NodePos { *t });
-              return enumerate.recommend_routes(false);
-            } else {
-
-              auto slacks = important_metrics_to_array<Dim>(important_metrics);
-
-              EnumerateOptimals<Dim, SimilarityPrioExcludeIrrelevant> enumerate(&g, *maxRoutes);
-              enumerate.set_overlap(overlap);
-              enumerate.set_slack(slacks);
-
-              enumerate.find(NodePos { *s }, NodePos { *t });
-              return enumerate.recommend_routes(false);
-            }
-          }();
-
-          try {
-
-            Json::Value result;
-            Json::Value points(Json::arrayValue);
-
-            for (size_t i = 0; i < routes.size(); ++i) {
-
-              Json::Value route;
-              Json::Value conf(Json::arrayValue);
-
-              for (const auto& v : configs[i].values) {
-                conf.append(v);
-              }
-              route["conf"] = conf;
-
-              route["route"] = routeToJson(routes[i], g);
-              route["selected"] = true;
+  server.resource["^/metrics$"]["GET"] = [&metrics](Response response, Request /*request*/) {
+    SimpleWeb::CaseInsensitiveMultimap header;
+    header.emplace("Content-Type", "text/plain; version=0.0.4");
+    response->write(SimpleWeb::StatusCode::success_ok, metrics.render(), header);
+  };
 
-              points.append(route);
+  if (options.admin_reload) {
+    server.resource["^/admin/reload$"]["POST"]
+        = [&reload](Response response, Request /*request*/) {
+            if (!reload()) {
+              response->write(SimpleWeb::StatusCode::client_error_conflict,
+                  "The graph is already being reloaded");
+              return;
             }
+            response->write(SimpleWeb::StatusCode::success_accepted, "Reloading graph");
+          };
+  }
 
-            result["points"] = points;
-            result["debug"] = log->getInfo();
-
-            SimpleWeb::CaseInsensitiveMultimap header;
-            header.emplace("Content-Type", "application/json");
-
-            Json::StreamWriterBuilder builder;
-
-            response->write(
-                SimpleWeb::StatusCode::success_ok, Json::writeString(builder, result), header);
-          } catch (std::exception& e) {
-            response->write(SimpleWeb::StatusCode::server_error_internal_server_error, e.what());
-          }
-        };
+  // Changed files are only reloaded after they stayed the same for a whole
+  // interval, so files still being written are not picked up.
+  std::mutex watchMutex;
+  std::condition_variable watchStopped;
+  bool stopWatching = false;
+  std::thread watcher;
+  if (options.watch_seconds > 0) {
+    watcher = std::thread([&]() {
+      auto lastWrite = [&graphFile]() {
+        boost::system::error_code error;
+        return boost::filesystem::last_write_time(graphFile, error);
+      };
+      auto loaded = lastWrite();
+      auto seen = loaded;
+      std::unique_lock<std::mutex> lock { watchMutex };
+      while (!watchStopped.wait_for(lock, std::chrono::seconds { options.watch_seconds },
+          [&stopWatching]() { return stopWatching; })) {
+        auto modified = lastWrite();
+        if (modified != loaded && modified == seen && reload()) {
+          loaded = modified;
+        }
+        seen = modified;
+      }
+    });
+  }
 
   std::cout << "Starting web server at http://localhost:" << server.config.port << '\n';
   server.start();
+
+  if (watcher.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock { watchMutex };
+      stopWatching = true;
+    }
+    watchStopped.notify_all();
+    watcher.join();
+  }
+  std::lock_guard<std::mutex> lock { reloadMutex };
+  if (reloadThread.joinable()) {
+    reloadThread.join();
+  }
 }
 
-template <int Dim> int testGraph(Graph<Dim>& g)
+template <int Dim> int testGraph(Graph<Dim>& g, size_t queries)
 {
   using Config = Config<Dim>;
-  using Edge = Edge<Dim>;
 
   auto d = g.createDijkstra();
-  auto n = g.createNormalDijkstra(true);
+  auto landmarksStart = std::chrono::high_resolution_clock::now();
+  Landmarks<Dim> landmarks { g };
+  auto landmarksEnd = std::chrono::high_resolution_clock::now();
+  std::cout << "computing " << landmarks.getNodes().size() << " landmarks took "
+            << std::chrono::duration_cast<ms>(landmarksEnd - landmarksStart).count() << "ms"
+            << '\n';
+  AltDijkstra<Dim> n { &g, &landmarks };
   std::random_device rd {};
   std::uniform_int_distribution<uint32_t> dist(0, g.getNodeCount() - 1);
   // Config c { std::vector<double>(Dim, 1.0 / Dim) };
@@ -327,7 +815,7 @@ template <int Dim> int testGraph(Graph<Dim>& g)
   size_t dPops = 0;
   size_t nPops = 0;
 
-  for (int i = 0; i < 200; ++i) {
+  for (size_t i = 0; i < queries; ++i) {
     NodePos from { dist(rd) };
     NodePos to { dist(rd) };
     Config c = generateRandomConfig<Dim>();
@@ -341,7 +829,7 @@ template <int Dim> int testGraph(Graph<Dim>& g)
     if (dRoute && nRoute) {
       auto normalTime = std::chrono::duration_cast<ms>(nEnd - dEnd).count();
       auto chTime = std::chrono::duration_cast<ms>(dEnd - dStart).count();
-      std::cout << "ND/CH: " << normalTime << "/" << chTime << " = "
+      std::cout << "ALT/CH: " << normalTime << "/" << chTime << " = "
                 << (chTime > 0 ? normalTime / chTime : 999999999999999) << '\n';
       dTime += chTime;
       nTime += normalTime;
@@ -366,18 +854,13 @@ template <int Dim> int testGraph(Graph<Dim>& g)
         printRoutes(wholeRoute, g, *nRoute, *dRoute, c);
         std::unordered_set<NodeId> nodeIds;
         std::transform(nRoute->edges.begin(), nRoute->edges.end(),
-            std::inserter(nodeIds, begin(nodeIds)), [](const auto& e) {
-              const auto& edge = Edge::getEdge(e);
-              return edge.getSourceId();
-            });
+            std::inserter(nodeIds, begin(nodeIds)),
+            [&g](const auto& e) { return g.getEdges().getSourceId(e); });
 
         auto idToPos = g.getNodePosByIds(nodeIds);
         std::vector<const Node*> nodeLevels;
         std::transform(nRoute->edges.begin(), nRoute->edges.end(), std::back_inserter(nodeLevels),
-            [&idToPos](const auto& e) {
-              const auto edge = Edge::getEdge(e);
-              return idToPos[edge.getSourceId()];
-            });
+            [&g, &idToPos](const auto& e) { return idToPos[g.getEdges().getSourceId(e)]; });
 
         size_t lower = 0;
         size_t upper = nodeLevels.size() - 1;
@@ -398,7 +881,7 @@ template <int Dim> int testGraph(Graph<Dim>& g)
               std::cout << "did not find correct subpath between " << nextToLastPos << " and "
                         << currentPos << " at index " << i << '\n';
 
-              std::cout << '\n' << "Normal dijkstra needs: ";
+              std::cout << '\n' << "ALT dijkstra needs: ";
               for (size_t i = 0; i < Dim; ++i) {
                 std::cout << nTest->costs.values[i] << ", ";
               }
@@ -426,7 +909,7 @@ template <int Dim> int testGraph(Graph<Dim>& g)
         return 1;
       }
     } else if (nRoute && !dRoute) {
-      std::cout << "Only Normal dijkstra found route form " << from << " to " << to << "!" << '\n';
+      std::cout << "Only ALT dijkstra found route form " << from << " to " << to << "!" << '\n';
       return 1;
     } else {
       ++noRoute;
@@ -440,9 +923,9 @@ template <int Dim> int testGraph(Graph<Dim>& g)
   std::cout << "Did not find a route in " << noRoute << " cases" << '\n';
   std::cout << "average speed up is " << static_cast<double>(nTime) / dTime << '\n';
   std::cout << "Average CH-Dijkstra time: " << static_cast<double>(dTime) / route << "ms" << '\n';
-  std::cout << "Average    Dijkstra time: " << static_cast<double>(nTime) / route << "ms" << '\n';
+  std::cout << "Average         ALT time: " << static_cast<double>(nTime) / route << "ms" << '\n';
   std::cout << "Average CH-Dijkstra pops: " << static_cast<double>(dPops) / route << '\n';
-  std::cout << "Average    Dijkstra pops: " << static_cast<double>(nPops) / route << '\n';
+  std::cout << "Average         ALT pops: " << static_cast<double>(nPops) / route << '\n';
   std::cout << "PQ-Pops ratio: " << static_cast<double>(nPops) / dPops << '\n';
   return 0;
 }
@@ -451,31 +934,54 @@ namespace po = boost::program_options;
 
 template <int Dim>
 int run(po::variables_map& vm, std::string& loadFileName, std::string& saveFileName,
-    unsigned short port, size_t max_refinements)
+    const ServerOptions& serverOptions)
 {
 
-  Graph<Dim> g { std::vector<Node>(), std::vector<Edge<Dim>>() };
-  if (vm.count("text") > 0) {
-    bool zipped_input = vm.count("zi") > 0;
-    g = loadGraphFromTextFile<Dim>(loadFileName, zipped_input);
-  } else if (vm.count("bin") > 0) {
-    g = loadGraphFromBinaryFile<Dim>(loadFileName);
-  } else {
+  if (vm.count("text") == 0 && vm.count("bin") == 0) {
     std::cout << "No input file given" << '\n';
     std::cout << "Maybe try --help" << '\n';
     return 0;
   }
+  // Also used by the web server to reload the graph.
+  auto loadGraph = [&vm, loadFileName]() mutable {
+    Graph<Dim> g { std::vector<Node>(), std::vector<Edge<Dim>>() };
+    if (vm.count("text") > 0) {
+      bool zipped_input = vm.count("zi") > 0;
+      g = loadGraphFromTextFile<Dim>(loadFileName, zipped_input);
+    } else {
+      g = loadGraphFromBinaryFile<Dim>(loadFileName);
+    }
+    if (vm.count("update-costs") > 0) {
+      auto updatesFile = vm["update-costs"].as<std::string>();
+      auto updates = loadCostUpdates<Dim>(updatesFile);
+      auto start = std::chrono::high_resolution_clock::now();
+      auto result = g.updateCosts(updates);
+      auto end = std::chrono::high_resolution_clock::now();
+      std::cout << "updated " << result.updatedEdges << " edges and " << result.updatedShortcuts
+                << " shortcuts in " << std::chrono::duration_cast<ms>(end - start).count()
+                << "ms" << '\n';
+      if (!result.flagged.empty()) {
+        std::cout << result.flagged.size()
+                  << " changed edges may invalidate witnesses of the contraction, routes may be "
+                     "suboptimal until the graph is contracted again"
+                  << '\n';
+      }
+    }
+    return g;
+  };
+  auto g = loadGraph();
   if (!saveFileName.empty()) {
     std::cout << "Saving" << '\n';
     saveToBinaryFile(g, saveFileName);
   }
 
   if (vm.count("test") > 0) {
-    return testGraph(g);
+    return testGraph(g, vm["test-queries"].as<size_t>());
   }
 
   if (vm.count("web") > 0) {
-    runWebServer(g, port, max_refinements);
+    runWebServer(std::move(g), std::function<Graph<Dim>()> { loadGraph }, loadFileName,
+        serverOptions);
   }
   return 0;
 }
@@ -486,8 +992,9 @@ int main(int argc, char* argv[])
 
   std::string loadFileName {};
   std::string saveFileName {};
-  unsigned short port = 8080;
-  size_t max_refinements = 1000;
+  const size_t cores
+      = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+  ServerOptions serverOptions { 8080, 1000, 2, cores, 64, 64, 2, 2, 0, false };
 
   unsigned short dim = 3;
 
@@ -500,13 +1007,33 @@ int main(int argc, char* argv[])
 
   po::options_description action { "actions" };
   action.add_options()("save", po::value<std::string>(&saveFileName), "save graph to binary file");
-  action.add_options()("test", "runs normal dijkstra and CH dijktra for comparison");
+  action.add_options()("update-costs", po::value<std::string>(),
+      "set new edge costs from a file of lines 'edge-id cost...' and update the shortcuts");
+  action.add_options()("test", "runs ALT dijkstra and CH dijktra for comparison");
+  action.add_options()("test-queries", po::value<size_t>()->default_value(200),
+      "number of random queries compared by --test");
   action.add_options()("web,w", "start webserver for interaction via browser");
 
   po::options_description web { "web options" };
-  web.add_options()("port", po::value<unsigned short>(&port), "port to listen on");
-  web.add_options()("max-refinements", po::value<size_t>(&max_refinements),
+  web.add_options()("port", po::value<unsigned short>(&serverOptions.port), "port to listen on");
+  web.add_options()("max-refinements", po::value<size_t>(&serverOptions.max_refinements),
       "Maximal allowed refinement limit for route enumeration");
+  web.add_options()("io-threads", po::value<size_t>(&serverOptions.io_threads),
+      "number of threads parsing requests and writing responses");
+  web.add_options()("compute-threads", po::value<size_t>(&serverOptions.compute_threads),
+      "number of threads computing routes");
+  web.add_options()("queue-depth", po::value<size_t>(&serverOptions.queue_depth),
+      "number of waiting route computations before requests are rejected");
+  web.add_options()("max-route-jobs", po::value<size_t>(&serverOptions.max_route_jobs),
+      "maximal number of queued or running /route requests");
+  web.add_options()("max-enumerate-jobs", po::value<size_t>(&serverOptions.max_enumerate_jobs),
+      "maximal number of queued or running /enumerate requests");
+  web.add_options()("max-batch-jobs", po::value<size_t>(&serverOptions.max_batch_jobs),
+      "maximal number of queued or running /route/batch requests");
+  web.add_options()("watch-graph", po::value<size_t>(&serverOptions.watch_seconds),
+      "check the graph file every given seconds and reload it when it changed");
+  web.add_options()("admin-reload", po::bool_switch(&serverOptions.admin_reload),
+      "reload the graph file on POST /admin/reload");
 
   po::options_description all;
   all.add_options()("help,h", "prints help message");
@@ -522,19 +1049,19 @@ int main(int argc, char* argv[])
   }
   switch (dim) {
   case 1: {
-    return run<1>(vm, loadFileName, saveFileName, port, max_refinements);
+    return run<1>(vm, loadFileName, saveFileName, serverOptions);
     break;
   }
   case 2: {
-    return run<2>(vm, loadFileName, saveFileName, port, max_refinements);
+    return run<2>(vm, loadFileName, saveFileName, serverOptions);
     break;
   }
   case 3: {
-    return run<3>(vm, loadFileName, saveFileName, port, max_refinements);
+    return run<3>(vm, loadFileName, saveFileName, serverOptions);
     break;
   }
   case 4: {
-    return run<4>(vm, loadFileName, saveFileName, port, max_refinements);
+    return run<4>(vm, loadFileName, saveFileName, serverOptions);
     break;
   }
   default:
@@ -0,0 +1,59 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "alt.hpp"
+#include "ndijkstra.hpp"
+#include "test_graphs.hpp"
+
+#include <random>
+#include <sstream>
+
+TEST_CASE("ALT finds the same costs as Dijkstra")
+{
+  std::istringstream file { gridGraphText(8, 8, 7, 0.25) };
+  auto g = Graph<3>::createFromStream(file);
+  Landmarks<3> landmarks { g, 4, 2 };
+  REQUIRE(landmarks.getNodes().size() == 4);
+
+  auto n = g.createNormalDijkstra();
+  AltDijkstra<3> alt { &g, &landmarks };
+  std::mt19937 gen { 42 };
+  std::uniform_int_distribution<uint32_t> dist(0, g.getNodeCount() - 1);
+  std::uniform_real_distribution<double> weight(0, 1);
+
+  for (size_t i = 0; i < 300; ++i) {
+    const NodePos from { dist(gen) };
+    const NodePos to { dist(gen) };
+    Config<3> config { std::vector<double> { weight(gen), weight(gen), weight(gen) } };
+
+    auto route = n.findBestRoute(from, to, config);
+    REQUIRE(landmarks.lowerBound(from, to, config) <= route->costs * config + 1e-6);
+
+    for (auto altRoute : { alt.findBestRoute(from, to, config),
+             alt.findBestRouteForward(from, to, config) }) {
+      REQUIRE(altRoute);
+      REQUIRE(altRoute->costs * config == Approx(route->costs * config));
+      auto node = from;
+      for (const auto& edge : altRoute->edges) {
+        REQUIRE(g.getEdges().sourcePos(edge) == node);
+        node = g.getEdges().destPos(edge);
+      }
+      REQUIRE(node == to);
+    }
+  }
+}
@@ -0,0 +1,73 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "compute_executor.hpp"
+
+#include <future>
+
+TEST_CASE("Admission limit caps concurrent jobs")
+{
+  AdmissionLimit limit { 2 };
+  REQUIRE(limit.try_acquire());
+  REQUIRE(limit.try_acquire());
+  REQUIRE_FALSE(limit.try_acquire());
+  limit.release();
+  REQUIRE(limit.in_use() == 1);
+  REQUIRE(limit.try_acquire());
+}
+
+TEST_CASE("Compute executor runs tasks on its workers")
+{
+  ComputeExecutor executor { 2, 10 };
+  std::promise<size_t> first;
+  std::promise<size_t> second;
+  REQUIRE(executor.try_submit([&first](size_t worker) { first.set_value(worker); }));
+  REQUIRE(executor.try_submit([&second](size_t worker) { second.set_value(worker); }));
+
+  REQUIRE(first.get_future().get() < executor.worker_count());
+  REQUIRE(second.get_future().get() < executor.worker_count());
+}
+
+TEST_CASE("Compute executor rejects work when saturated")
+{
+  std::promise<void> unblock;
+  auto blocked = unblock.get_future().share();
+  std::promise<void> started;
+
+  ComputeExecutor executor { 1, 1 };
+  AdmissionLimit limit { 3 };
+
+  REQUIRE(executor.try_submit(limit, [&started, blocked](size_t) {
+    started.set_value();
+    blocked.wait();
+  }));
+  started.get_future().wait();
+
+  std::promise<void> done;
+  REQUIRE(executor.try_submit(limit, [&done](size_t) { done.set_value(); }));
+  // The queue is full, the limit must not leak the rejected job.
+  REQUIRE_FALSE(executor.try_submit(limit, [](size_t) {}));
+  REQUIRE(limit.in_use() == 2);
+
+  unblock.set_value();
+  done.get_future().wait();
+  while (limit.in_use() > 0) {
+    std::this_thread::yield();
+  }
+  REQUIRE(limit.in_use() == 0);
+}
@@ -0,0 +1,64 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "contractionLP.hpp"
+
+TEST_CASE("Contraction LP finds configurations without witness")
+{
+  using Cost = Cost<2>;
+  ContractionLp<2> lp;
+
+  lp.reset(Cost { std::vector<double> { 2, 2 } });
+  lp.addConstraint(Cost { std::vector<double> { 1, 4 } });
+  lp.addConstraint(Cost { std::vector<double> { 4, 1 } });
+  REQUIRE(lp.solve() == ContractionLp<2>::Result::Cheaper);
+  auto values = lp.variableValues();
+  REQUIRE(values[0] == Approx(0.5));
+  REQUIRE(values[1] == Approx(0.5));
+
+  lp.reset(Cost { std::vector<double> { 2, 2 } });
+  lp.addConstraint(Cost { std::vector<double> { 1, 3 } });
+  lp.addConstraint(Cost { std::vector<double> { 3, 1 } });
+  REQUIRE(lp.solve() == ContractionLp<2>::Result::Dominated);
+}
+
+TEST_CASE("Contraction LP gives the same answer for large problems")
+{
+  using Cost = Cost<3>;
+  ContractionLp<3> lp;
+  const Cost shortcut { std::vector<double> { 3, 3, 3 } };
+  const std::vector<Cost> witnesses { Cost { std::vector<double> { 1, 5, 5 } },
+    Cost { std::vector<double> { 5, 1, 5 } }, Cost { std::vector<double> { 5, 5, 1 } } };
+
+  // Small problems take the fast path, repeated rows make GLPK solve it.
+  for (size_t repetitions : { 1, 20 }) {
+    lp.reset(shortcut);
+    for (size_t i = 0; i < repetitions; ++i) {
+      for (const auto& witness : witnesses) {
+        lp.addConstraint(witness);
+      }
+    }
+    REQUIRE(lp.solve() == ContractionLp<3>::Result::Cheaper);
+    for (auto value : lp.variableValues()) {
+      REQUIRE(value == Approx(1.0 / 3));
+    }
+
+    lp.addConstraint(Cost { std::vector<double> { 3, 3, 2 } });
+    REQUIRE(lp.solve() == ContractionLp<3>::Result::Dominated);
+  }
+}
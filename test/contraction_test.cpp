@@ -0,0 +1,95 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "contraction.hpp"
+#include "ndijkstra.hpp"
+#include "test_graphs.hpp"
+
+#include <sstream>
+
+TEST_CASE("Contracted graph answers queries like the original")
+{
+  const auto file = gridGraphText(5, 5, 42);
+
+  std::istringstream uncontracted { file };
+  auto contraction = Contraction<3>::createFromStream(uncontracted);
+  ContractionOptions options {};
+  options.threadCount = 2;
+  contraction.contract(options);
+  REQUIRE(contraction.getRounds() > 1);
+  REQUIRE(contraction.getEdges().size() == 80 + contraction.getShortcutCount());
+
+  std::stringstream contracted;
+  contraction.writeText(contracted);
+  auto ch = Graph<3>::createFromStream(contracted);
+  std::istringstream originalFile { file };
+  auto original = Graph<3>::createFromStream(originalFile);
+  REQUIRE(ch.getNodeCount() == 25);
+  REQUIRE(ch.getEdgeCount() == contraction.getEdges().size());
+
+  auto d = ch.createDijkstra();
+  auto n = original.createNormalDijkstra();
+  const auto& chEdges = ch.getEdges();
+  const std::vector<Config<3>> configs { Config<3> { std::vector<double> { 1, 0, 0 } },
+    Config<3> { std::vector<double> { 0, 1, 0 } }, Config<3> { std::vector<double> { 0, 0, 1 } },
+    Config<3> { std::vector<double> { 0.2, 0.3, 0.5 } } };
+  for (const auto& config : configs) {
+    for (uint32_t s = 0; s < 25; ++s) {
+      for (uint32_t t = 0; t < 25; ++t) {
+        auto chRoute = d.findBestRoute(
+            *ch.nodePosById(NodeId { s }), *ch.nodePosById(NodeId { t }), config);
+        auto route = n.findBestRoute(
+            *original.nodePosById(NodeId { s }), *original.nodePosById(NodeId { t }), config);
+        REQUIRE(chRoute);
+        REQUIRE(route);
+        REQUIRE(chRoute->costs * config == Approx(route->costs * config));
+
+        // Routes are unpacked into connected original edges.
+        Cost<3> unpacked {};
+        for (size_t i = 0; i < chRoute->edges.size(); ++i) {
+          const auto edge = chRoute->edges[i];
+          REQUIRE_FALSE(chEdges.getEdgeA(edge));
+          if (i > 0) {
+            REQUIRE(chEdges.sourcePos(edge) == chEdges.destPos(chRoute->edges[i - 1]));
+          }
+          unpacked = unpacked + chEdges.getCost(edge);
+        }
+        REQUIRE(unpacked * config == Approx(route->costs * config));
+      }
+    }
+  }
+}
+
+TEST_CASE("Contraction rejects contracted graphs")
+{
+  std::string file { R"!!(# Build by: contraction_test
+
+3
+3
+3
+0 163354 48.6674338 9.2445911 380 0
+1 163355 48.6694744 9.2432625 380 0
+2 163358 48.6661932 9.2515536 386 1
+0 1 0.0 3 1 -1 -1
+1 2 0.0 5 1 -1 -1
+0 2 0.0 8 2 0 1
+)!!" };
+
+  std::istringstream iss { file };
+  REQUIRE_THROWS(Contraction<3>::createFromStream(iss));
+}
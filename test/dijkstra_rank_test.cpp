@@ -0,0 +1,62 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "dijkstra_rank.hpp"
+#include "test_graphs.hpp"
+
+#include <random>
+#include <sstream>
+
+TEST_CASE("Dijkstra rank queries follow the settle order")
+{
+  // A path 0 -> 1 -> ... -> 9, so node i is settled at rank i from node 0.
+  std::istringstream file { gridGraphText(10, 1, 3, 1.0, 1, 2) };
+  auto g = Graph<2>::createFromStream(file);
+
+  std::mt19937_64 gen { 3 };
+  auto queries = dijkstraRankQueries(g, 20, gen);
+  REQUIRE_FALSE(queries.empty());
+  for (const auto& q : queries) {
+    REQUIRE(static_cast<size_t>(q.to - q.from) == q.rank);
+    REQUIRE((q.rank & (q.rank - 1)) == 0);
+  }
+  auto fromZero = std::find_if(
+      queries.begin(), queries.end(), [](const auto& q) { return q.from == NodePos { 0 }; });
+  if (fromZero != queries.end()) {
+    REQUIRE(fromZero->rank == 1);
+  }
+
+  std::stringstream stored;
+  writeRankQueries(stored, queries);
+  auto read = readRankQueries<2>(stored, g.getNodeCount());
+  REQUIRE(read.size() == queries.size());
+  for (size_t i = 0; i < read.size(); ++i) {
+    REQUIRE(read[i].rank == queries[i].rank);
+    REQUIRE(read[i].from == queries[i].from);
+    REQUIRE(read[i].to == queries[i].to);
+    REQUIRE(read[i].config.values == queries[i].config.values);
+  }
+
+  std::istringstream broken { "4 1 5 0.5\n" };
+  REQUIRE_THROWS_AS(readRankQueries<2>(broken, g.getNodeCount()), std::invalid_argument);
+
+  std::ostringstream outside;
+  outside << "4 1 " << g.getNodeCount() << " 0.5 0.5\n";
+  std::istringstream unknownNode { outside.str() };
+  REQUIRE_THROWS_AS(readRankQueries<2>(unknownNode, g.getNodeCount()), std::invalid_argument);
+}
@@ -19,6 +19,8 @@
 #include "catch.hpp"
 #include "edge_load.hpp"
 
+#include <sstream>
+
 TEST_CASE("Test edge load Computation")
 {
 
@@ -96,3 +98,41 @@ TEST_CASE("Test edge load Computation")
     REQUIRE(l.avg_load() == 0.5);
   }
 }
+
+TEST_CASE("Edge loads from many routes on several threads")
+{
+  std::vector<Route<2>> routes;
+  for (uint32_t i = 0; i < 5000; ++i) {
+    Route<2> r;
+    for (uint32_t e = 100 + i % 7; e < 400 + i % 13; e += 1 + i % 5) {
+      // Spread out so the CSV is written in parts as well.
+      r.edges.push_back(EdgeId(e * 1000));
+    }
+    routes.push_back(r);
+  }
+
+  EdgeLoads<2> parallel(routes, 4);
+  EdgeLoads<2> incremental;
+  for (const auto& route : routes) {
+    incremental.add(route);
+  }
+  for (uint32_t e = 90; e < 420; ++e) {
+    REQUIRE(parallel[EdgeId(e * 1000)] == incremental[EdgeId(e * 1000)]);
+  }
+  REQUIRE(parallel[EdgeId(50)] == 0.0);
+  REQUIRE(parallel.max_load() == incremental.max_load());
+  REQUIRE(parallel.avg_load() == incremental.avg_load());
+
+  std::ostringstream parallelCsv;
+  parallel.write_csv(parallelCsv, 4);
+  std::ostringstream incrementalCsv;
+  incremental.write_csv(incrementalCsv, 1);
+  REQUIRE(parallelCsv.str() == incrementalCsv.str());
+
+  // Edges below the range seen so far extend it.
+  Route<2> low;
+  low.edges.push_back(EdgeId(3));
+  incremental.add(low);
+  REQUIRE(incremental[EdgeId(3)] == 1.0 / 5001);
+  REQUIRE(incremental[EdgeId(100000)] == Approx(parallel[EdgeId(100000)] * 5000 / 5001));
+}
@@ -0,0 +1,81 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "experiment_driver.hpp"
+
+#include <sstream>
+
+TEST_CASE("Experiment rows keep the job order")
+{
+  struct State { };
+  std::vector<ExperimentJob<State>> jobs;
+  for (size_t i = 0; i < 200; ++i) {
+    auto run = [i](State&) {
+      // Later jobs finish first now and then.
+      std::this_thread::sleep_for(std::chrono::microseconds((200 - i) % 7 * 100));
+      return i % 10 == 3 ? std::string {} : csvKey("day", i, i * i) + '\n';
+    };
+    jobs.push_back(ExperimentJob<State> { csvKey("day", i), run });
+  }
+
+  std::stringstream out;
+  out << "type,i,square\n";
+  REQUIRE(runExperiment(jobs, {}, out, 4, []() { return State {}; }) == 200);
+  std::string header;
+  std::getline(out, header);
+  for (size_t i = 0; i < 200; ++i) {
+    if (i % 10 == 3) {
+      continue;
+    }
+    std::string line;
+    REQUIRE(std::getline(out, line));
+    REQUIRE(line == csvKey("day", i, i * i));
+  }
+
+  out.clear();
+  out.seekg(0);
+  auto done = readDoneKeys(out, { 0, 1 });
+  REQUIRE(done.size() == 180);
+  REQUIRE(done.count(csvKey("day", 42)) == 1);
+  REQUIRE(done.count(csvKey("day", 43)) == 0);
+
+  std::stringstream resumed;
+  REQUIRE(runExperiment(jobs, done, resumed, 4, []() { return State {}; }) == 20);
+  REQUIRE(resumed.str().empty());
+}
+
+TEST_CASE("Done keys respect quotes and skip cut off rows")
+{
+  std::istringstream file { "a,b,\"c\",d\n1,2,\"x,y\",4\n5,6,\"z\",7\n8,9\n" };
+  auto done = readDoneKeys(file, { 0, 2 });
+  REQUIRE(done.size() == 2);
+  REQUIRE(done.count("1,\"x,y\"") == 1);
+  REQUIRE(done.count("5,\"z\"") == 1);
+}
+
+TEST_CASE("Partial rows of a killed run are cut off")
+{
+  std::istringstream killed { "a,b\n1,2\n3,4" };
+  REQUIRE(completeRowsLength(killed) == 8);
+
+  std::istringstream complete { "a,b\n1,2\n" };
+  REQUIRE(completeRowsLength(complete) == 8);
+
+  std::istringstream empty { "" };
+  REQUIRE(completeRowsLength(empty) == 0);
+}
@@ -18,6 +18,11 @@
 #include "catch.hpp"
 #include "dijkstra.hpp"
 
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <set>
+#include <sstream>
+
 TEST_CASE("Offset array is correctly initialized")
 {
   using Edge = Edge<3>;
@@ -74,7 +79,6 @@ TEST_CASE("Read small file into graph")
 
 )!!" };
   using Graph = Graph<3>;
-  using Edge = Edge<3>;
   using Config = Config<3>;
 
   auto iss = std::istringstream(file);
@@ -86,9 +90,82 @@ TEST_CASE("Read small file into graph")
 
   REQUIRE(optionalRoute.has_value());
   auto route = optionalRoute.value();
-  REQUIRE(Edge::getSourceId(route.edges[0]) == 0);
-  REQUIRE(Edge::getSourceId(route.edges[1]) == 1);
+  REQUIRE(g.getEdges().getSourceId(route.edges[0]) == 0);
+  REQUIRE(g.getEdges().getSourceId(route.edges[1]) == 1);
   REQUIRE(route.costs.values[0] == 101);
   REQUIRE(route.costs.values[1] == 4);
   REQUIRE(route.costs.values[2] == 140);
 }
+
+TEST_CASE("Binary graphs keep their own edges")
+{
+  std::string file { R"!!(# Type : chgraph
+
+3
+3
+3
+0 163354 48.6674338 9.2445911 380 0
+1 163355 48.6694744 9.2432625 380 0
+2 163358 48.6661932 9.2515536 386 1
+0 1 0.0 3 1 -1 -1
+1 2 0.0 5 1 -1 -1
+0 2 0.0 8 2 0 1
+)!!" };
+  using Graph = Graph<3>;
+
+  auto edgeIds = [](const Graph& graph) {
+    std::set<uint32_t> ids;
+    for (uint32_t n = 0; n < graph.getNodeCount(); ++n) {
+      for (const auto& edge : graph.getOutgoingEdgesOf(NodePos { n })) {
+        ids.insert(edge.id);
+      }
+    }
+    return ids;
+  };
+
+  auto iss = std::istringstream(file);
+  Graph g = Graph::createFromStream(iss);
+  std::stringstream binary;
+  {
+    boost::archive::binary_oarchive out { binary };
+    out << g;
+  }
+  const auto saved = binary.str();
+
+  // Loading the same file twice, like a server replacing its graph.
+  for (size_t i = 0; i < 2; ++i) {
+    std::istringstream in { saved };
+    boost::archive::binary_iarchive bin { in };
+    auto loaded = Graph::createFromBinaryFile(bin);
+    const auto ids = edgeIds(loaded);
+    REQUIRE(ids.size() == 3);
+    REQUIRE(ids == std::set<uint32_t> { 0, 1, 2 });
+
+    const auto& edges = loaded.getEdges();
+    for (const auto& edge : loaded.getOutgoingEdgesOf(*loaded.nodePosById(NodeId { 0 }))) {
+      const auto& edgeA = edges.getEdgeA(edge.id);
+      if (edgeA) {
+        const auto& edgeB = *edges.getEdgeB(edge.id);
+        REQUIRE(ids.count(*edgeA) == 1);
+        REQUIRE(ids.count(edgeB) == 1);
+        REQUIRE(edges.getSourceId(*edgeA) == 0);
+        REQUIRE(edges.getDestId(*edgeA) == 1);
+        REQUIRE(edges.getSourceId(edgeB) == 1);
+        REQUIRE(edges.getDestId(edgeB) == 2);
+      }
+    }
+
+    auto snapped = loaded.getSegmentIndex().findNextSegment(Lat { 48.6674 }, Lng { 9.2446 });
+    REQUIRE(snapped);
+    REQUIRE(ids.count(snapped->edge) == 1);
+    REQUIRE(edges.sourcePos(snapped->edge) == snapped->source);
+    REQUIRE(edges.destPos(snapped->edge) == snapped->target);
+    REQUIRE(edges.getSourceId(snapped->edge) == loaded.getNode(snapped->source).id());
+  }
+
+  // The first graph is untouched by the loaded ones going away.
+  auto route = g.createDijkstra().findBestRoute(NodePos { 0 }, NodePos { 2 },
+      Config<3> { LengthConfig { 0 }, HeightConfig { 1.0 }, UnsuitabilityConfig { 0 } });
+  REQUIRE(route);
+  REQUIRE(route->costs.values[1] == 8);
+}
@@ -20,6 +20,11 @@
 
 #include "graph.hpp"
 
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <random>
+#include <sstream>
+
 TEST_CASE("Find next Node, with only one node")
 {
   std::vector<Node> nodes {};
@@ -49,3 +54,144 @@ TEST_CASE("Find next Node, with great distance")
   Grid grid { nodes };
   REQUIRE(grid.findNextNode(Lat { 55 }, Lng { 16 }).value() == NodePos { 1 });
 }
+
+TEST_CASE("Find next Node without nodes")
+{
+  std::vector<Node> nodes {};
+  Grid grid { nodes };
+  REQUIRE_FALSE(grid.findNextNode(Lat { 48.5 }, Lng { 8.3 }));
+}
+
+TEST_CASE("Find next Node agrees with brute force search")
+{
+  std::mt19937 gen { 42 };
+  std::uniform_real_distribution<double> latDist { 47.0, 55.0 };
+  std::uniform_real_distribution<double> lngDist { 6.0, 15.0 };
+  std::normal_distribution<double> cityDist { 0.0, 0.005 };
+
+  std::vector<Node> nodes {};
+  for (uint32_t i = 0; i < 5000; ++i) {
+    nodes.emplace_back(NodeId { i }, Lat { latDist(gen) }, Lng { lngDist(gen) }, 0);
+  }
+  // A dense city where the old uniform grid had most nodes in one cell.
+  for (uint32_t i = 5000; i < 20000; ++i) {
+    nodes.emplace_back(
+        NodeId { i }, Lat { 48.77 + cityDist(gen) }, Lng { 9.18 + cityDist(gen) }, 0);
+  }
+
+  Grid grid { nodes };
+
+  std::uniform_real_distribution<double> queryLat { 46.0, 56.0 };
+  std::uniform_real_distribution<double> queryLng { 5.0, 16.0 };
+  for (size_t q = 0; q < 500; ++q) {
+    Lat lat { q % 2 == 0 ? queryLat(gen) : 48.77 + cityDist(gen) };
+    Lng lng { q % 2 == 0 ? queryLng(gen) : 9.18 + cityDist(gen) };
+    PositionalNode target { lat, lng, NodePos { 0 } };
+
+    double bestDist = std::numeric_limits<double>::max();
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+      PositionalNode node { nodes[i].lat(), nodes[i].lng(), NodePos { i } };
+      bestDist = std::min(bestDist, haversine_distance(target, node));
+    }
+
+    auto found = grid.findNextNode(lat, lng);
+    REQUIRE(found);
+    const auto& foundNode = nodes[*found];
+    PositionalNode foundPos { foundNode.lat(), foundNode.lng(), *found };
+    REQUIRE(haversine_distance(target, foundPos) == Approx(bestDist).margin(1e-6));
+  }
+}
+
+TEST_CASE("Snapping in batches keeps the input order")
+{
+  std::mt19937 gen { 7 };
+  std::uniform_real_distribution<double> latDist { 47.0, 55.0 };
+  std::uniform_real_distribution<double> lngDist { 6.0, 15.0 };
+
+  std::vector<Node> nodes {};
+  for (uint32_t i = 0; i < 5000; ++i) {
+    nodes.emplace_back(NodeId { i }, Lat { latDist(gen) }, Lng { lngDist(gen) }, 0);
+  }
+  Grid grid { nodes };
+
+  std::vector<LatLng> coordinates;
+  for (size_t q = 0; q < 5000; ++q) {
+    coordinates.push_back(LatLng { Lat { latDist(gen) }, Lng { lngDist(gen) } });
+  }
+
+  REQUIRE(grid.findNextNodes({}).empty());
+  for (size_t threads : { 1, 4 }) {
+    auto result = grid.findNextNodes(coordinates, threads);
+    REQUIRE(result.size() == coordinates.size());
+    for (size_t i = 0; i < coordinates.size(); ++i) {
+      REQUIRE(result[i] == grid.findNextNode(coordinates[i].lat, coordinates[i].lng));
+    }
+  }
+}
+
+TEST_CASE("Grid survives a binary archive")
+{
+  std::mt19937 gen { 3 };
+  std::uniform_real_distribution<double> latDist { 47.0, 55.0 };
+  std::uniform_real_distribution<double> lngDist { 6.0, 15.0 };
+
+  std::vector<Node> nodes {};
+  for (uint32_t i = 0; i < 1000; ++i) {
+    nodes.emplace_back(NodeId { i }, Lat { latDist(gen) }, Lng { lngDist(gen) }, 0);
+  }
+  Grid grid { nodes };
+
+  std::stringstream binary;
+  {
+    boost::archive::binary_oarchive out { binary };
+    out << grid;
+  }
+  Grid loaded { std::vector<Node> {} };
+  boost::archive::binary_iarchive in { binary };
+  in >> loaded;
+
+  REQUIRE(loaded.size() == grid.size());
+  REQUIRE(loaded.bounding_box().lat_min == grid.bounding_box().lat_min);
+  for (size_t q = 0; q < 200; ++q) {
+    Lat lat { latDist(gen) };
+    Lng lng { lngDist(gen) };
+    REQUIRE(loaded.findNextNode(lat, lng) == grid.findNextNode(lat, lng));
+  }
+}
+
+namespace {
+// Writes the fields of a Grid in its archive layout, with leaf ranges beyond
+// the stored nodes like a truncated file.
+struct StaleGrid {
+  template <class Archive> void serialize(Archive& ar, const unsigned int /*version*/)
+  {
+    BoundingBox bBox;
+    std::vector<double> coords { 1.0 };
+    std::vector<uint32_t> positions { 0 };
+    std::vector<double> bounds(6, 0.0);
+    std::vector<uint32_t> ranges { 0, 17 };
+    size_t leafLevel = 0;
+    ar& bBox;
+    ar& coords;
+    ar& coords;
+    ar& coords;
+    ar& positions;
+    ar& bounds;
+    ar& ranges;
+    ar& leafLevel;
+  }
+};
+}
+
+TEST_CASE("Grid rejects leaves beyond its nodes")
+{
+  std::stringstream binary;
+  {
+    boost::archive::binary_oarchive out { binary };
+    const StaleGrid stale {};
+    out << stale;
+  }
+  Grid loaded { std::vector<Node> {} };
+  boost::archive::binary_iarchive in { binary };
+  REQUIRE_THROWS_AS(in >> loaded, std::runtime_error);
+}
@@ -0,0 +1,99 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "metrics.hpp"
+
+#include <thread>
+
+TEST_CASE("Histogram buckets keep relative precision")
+{
+  for (uint64_t value : { 0ul, 1ul, 31ul, 32ul, 33ul, 1000ul, 123456789ul, 1ul << 62 }) {
+    auto index = Histogram::bucket_index(value);
+    REQUIRE(index < Histogram::BUCKET_COUNT);
+    auto upper = Histogram::bucket_upper_bound(index);
+    REQUIRE(upper >= value);
+    REQUIRE(upper - value <= value / Histogram::SUB_BUCKETS);
+    if (index > 0) {
+      REQUIRE(Histogram::bucket_upper_bound(index - 1) < value);
+    }
+  }
+  REQUIRE(Histogram::bucket_index(~0ul) == Histogram::BUCKET_COUNT - 1);
+}
+
+TEST_CASE("Histogram quantiles")
+{
+  Histogram h;
+  REQUIRE(h.quantile(0.99) == 0);
+
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    h.record(i);
+  }
+  REQUIRE(h.count() == 1000);
+  REQUIRE(h.sum() == 500500);
+  REQUIRE(h.quantile(0.5) >= 500);
+  REQUIRE(h.quantile(0.5) <= 515);
+  REQUIRE(h.quantile(0.99) >= 990);
+  REQUIRE(h.quantile(0.99) <= 1020);
+  REQUIRE(h.quantile(1.0) >= 1000);
+}
+
+TEST_CASE("Concurrent recording loses no values")
+{
+  MetricsRegistry registry;
+  auto& counter = registry.counter("test_total", "help");
+  auto& histogram = registry.histogram("test_values", "help");
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() {
+      for (uint64_t i = 0; i < 10000; ++i) {
+        counter.add();
+        histogram.record(i);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  REQUIRE(counter.get() == 40000);
+  REQUIRE(histogram.count() == 40000);
+}
+
+TEST_CASE("Metrics are rendered in the Prometheus text format")
+{
+  MetricsRegistry registry;
+  registry.counter("requests_total", "Received requests", { { "endpoint", "/route" } }).add(3);
+  registry.counter("requests_total", "Received requests", { { "endpoint", "/enumerate" } });
+  registry.histogram("duration_seconds", "Duration", { { "endpoint", "/route" } }, 1e-6)
+      .record(2000);
+  registry.gauge("queue_depth", "Waiting requests", []() { return 7; });
+
+  REQUIRE_THROWS(registry.gauge("requests_total", "wrong type", []() { return 0; }));
+
+  auto text = registry.render();
+  REQUIRE(text.find("# TYPE requests_total counter\n") != std::string::npos);
+  REQUIRE(text.find("requests_total{endpoint=\"/route\"} 3\n") != std::string::npos);
+  REQUIRE(text.find("requests_total{endpoint=\"/enumerate\"} 0\n") != std::string::npos);
+  REQUIRE(text.find("# TYPE duration_seconds summary\n") != std::string::npos);
+  REQUIRE(text.find("duration_seconds{endpoint=\"/route\",quantile=\"0.99\"} 0.002")
+      != std::string::npos);
+  REQUIRE(text.find("duration_seconds_count{endpoint=\"/route\"} 1\n") != std::string::npos);
+  REQUIRE(text.find("queue_depth 7\n") != std::string::npos);
+  // Families are only introduced once.
+  REQUIRE(text.find("# HELP requests_total") == text.rfind("# HELP requests_total"));
+}
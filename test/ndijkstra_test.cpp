@@ -18,6 +18,8 @@
 #include "catch.hpp"
 #include "graph.hpp"
 #include "ndijkstra.hpp"
+#include "test_graphs.hpp"
+#include <set>
 #include <sstream>
 
 TEST_CASE("Find other route with same costs")
@@ -59,4 +61,83 @@ TEST_CASE("Find other route with same costs")
 
   REQUIRE(routeIter.finished());
   REQUIRE(allRoutes.size() == 2);
+
+  // Nothing of earlier queries is left behind.
+  route = d.findBestRoute(NodePos { 1 }, NodePos { 2 }, config);
+  REQUIRE(route->pathCount == 1);
+  route = d.findBestRoute(NodePos { 0 }, NodePos { 2 }, config);
+  REQUIRE(route->pathCount == 2);
+  auto secondIter = d.routeIter(NodePos { 0 }, NodePos { 2 });
+  REQUIRE(secondIter.next());
+  REQUIRE(secondIter.next());
+  REQUIRE(secondIter.finished());
+}
+
+TEST_CASE("Cycles back to the source at no cost are ignored")
+{
+
+  const std::string threeNodeGraph { R"!!(# Build by: pbfextractor
+# Build on: SystemTime { tv_sec: 1512985452, tv_nsec: 881838750 }
+
+3
+3
+3
+0 163354 48.6674338 9.2445911 380 0
+1 163355 48.6694744 9.2432625 380 0
+2 163358 48.6661932 9.2515536 386 0
+0 1 0.0 0 1 -1 -1
+1 0 0.0 0 1 -1 -1
+1 2 0.0 5 1 -1 -1
+
+)!!" };
+
+  using Graph = Graph<3>;
+  using Config = Config<3>;
+
+  std::istringstream iss(threeNodeGraph);
+  Graph g = Graph::createFromStream(iss);
+
+  NormalDijkstra d = g.createNormalDijkstra();
+
+  Config config { LengthConfig { 0.0 }, HeightConfig { 1.0 }, UnsuitabilityConfig { 0.0 } };
+  auto route = d.findBestRoute(NodePos { 0 }, NodePos { 2 }, config);
+  REQUIRE(route);
+  REQUIRE(route->pathCount == 1);
+  REQUIRE(route->edges.size() == 2);
+}
+
+TEST_CASE("Enumerate all routes with the same costs")
+{
+  // 4x4 grid with edges to the right and down, every monotone route from the
+  // top left to the bottom right corner is a shortest one.
+  const uint32_t width = 4;
+  std::istringstream file { gridGraphText(width, width, 0, 1.0, 1) };
+
+  using Graph = Graph<3>;
+  using Config = Config<3>;
+
+  Graph g = Graph::createFromStream(file);
+  const auto& edges = g.getEdges();
+  auto d = g.createNormalDijkstra();
+  Config config { LengthConfig { 1.0 }, HeightConfig { 0.0 }, UnsuitabilityConfig { 0.0 } };
+  const auto from = *g.nodePosById(NodeId { 0 });
+  const auto to = *g.nodePosById(NodeId { width * width - 1 });
+  auto route = d.findBestRoute(from, to, config);
+  REQUIRE(route->pathCount == 20);
+
+  std::set<std::deque<EdgeId>> found;
+  auto routeIter = d.routeIter(from, to);
+  while (!routeIter.finished()) {
+    auto next = routeIter.next();
+    REQUIRE(next);
+    REQUIRE(next->edges.size() == 6);
+    REQUIRE(next->costs.values[0] == Approx(6));
+    REQUIRE(edges.sourcePos(next->edges.front()) == from);
+    REQUIRE(edges.destPos(next->edges.back()) == to);
+    for (size_t i = 1; i < next->edges.size(); ++i) {
+      REQUIRE(edges.sourcePos(next->edges[i]) == edges.destPos(next->edges[i - 1]));
+    }
+    found.insert(next->edges);
+  }
+  REQUIRE(found.size() == 20);
 }
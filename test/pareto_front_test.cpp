@@ -0,0 +1,66 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "pareto_front.hpp"
+
+#include <random>
+
+TEST_CASE("Pareto front keeps exactly the non-dominated costs")
+{
+  std::mt19937 gen { 7 };
+  // Few distinct values to get equal costs in some metrics.
+  std::uniform_int_distribution<int> value { 0, 30 };
+  auto random = [&]() { return static_cast<double>(value(gen)); };
+
+  std::vector<Cost<3>> inserted;
+  ParetoFront<3, size_t> front;
+  size_t removedCount = 0;
+  for (size_t i = 0; i < 500; ++i) {
+    const Cost<3> c { std::vector<double> { random(), random(), random() } };
+    const bool dominated = std::any_of(inserted.begin(), inserted.end(),
+        [&c](const auto& other) { return dominates(other, c); });
+    REQUIRE(front.dominates(c) == dominated);
+    REQUIRE(front.insert(c, i, [&](size_t) { ++removedCount; }) == !dominated);
+    if (!dominated) {
+      inserted.push_back(c);
+    }
+  }
+
+  std::vector<size_t> expected;
+  for (size_t i = 0; i < inserted.size(); ++i) {
+    const auto& c = inserted[i];
+    if (std::none_of(inserted.begin(), inserted.end(),
+            [&c](const auto& other) { return !(other == c) && dominates(other, c); })) {
+      expected.push_back(i);
+    }
+  }
+  REQUIRE(front.size() == expected.size());
+  REQUIRE(removedCount == inserted.size() - front.size());
+
+  for (size_t i = 0; i < front.size(); ++i) {
+    if (i > 0) {
+      REQUIRE(front.getCost(i - 1).values[0] <= front.getCost(i).values[0]);
+    }
+    REQUIRE(std::any_of(expected.begin(), expected.end(),
+        [&](size_t j) { return inserted[j] == front.getCost(i); }));
+  }
+
+  front.clear();
+  REQUIRE(front.empty());
+  REQUIRE_FALSE(front.dominates(inserted.front()));
+}
@@ -0,0 +1,62 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "all_paths.hpp"
+#include "catch.hpp"
+#include "pareto_search.hpp"
+#include "test_graphs.hpp"
+
+#include <sstream>
+
+TEST_CASE("Pareto search finds the same front as all paths")
+{
+  // A 3x4 grid with edges in both directions and small random costs, so some
+  // routes share their costs.
+  const uint32_t width = 3;
+  const uint32_t height = 4;
+  std::istringstream file { gridGraphText(width, height, 42, 0.0, 9) };
+  auto g = Graph<3>::createFromStream(file);
+
+  ParetoSearch<3> search { &g };
+  for (uint32_t s = 0; s < width * height; s += 5) {
+    for (uint32_t t = 0; t < width * height; ++t) {
+      auto expected = pareto_only(find_all_paths(g, NodePos { s }, NodePos { t }));
+      auto routes = search.run(NodePos { s }, NodePos { t });
+      if (s == t) {
+        REQUIRE(routes.size() == 1);
+        REQUIRE(routes.front().edges.empty());
+        continue;
+      }
+      REQUIRE(routes.size() == expected.size());
+
+      for (size_t i = 1; i < routes.size(); ++i) {
+        REQUIRE(routes[i - 1].costs.values < routes[i].costs.values);
+      }
+      for (const auto& route : routes) {
+        REQUIRE(std::any_of(expected.begin(), expected.end(),
+            [&](const auto& r) { return r.costs == route.costs; }));
+        REQUIRE(g.getEdges().sourcePos(route.edges.front()) == NodePos { s });
+        REQUIRE(g.getEdges().destPos(route.edges.back()) == NodePos { t });
+        Cost<3> sum;
+        for (const auto& edge : route.edges) {
+          sum = sum + g.getEdges().getCost(edge);
+        }
+        REQUIRE(sum == route.costs);
+      }
+    }
+  }
+}
@@ -0,0 +1,167 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "catch.hpp"
+#include "polyline_simplification.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+const double METERS_PER_DEGREE = 6371007.2 * M_PI / 180;
+
+LatLng offset(double north, double east)
+{
+  const double lat0 = 48.7;
+  const double lng0 = 9.1;
+  const double lng_scale = std::cos(lat0 * M_PI / 180);
+  return LatLng { Lat { lat0 + north / METERS_PER_DEGREE },
+    Lng { lng0 + east / (METERS_PER_DEGREE * lng_scale) } };
+}
+
+double segment_distance(const LatLng& p, const LatLng& a, const LatLng& b)
+{
+  const double lng_scale = std::cos(a.lat * M_PI / 180) * METERS_PER_DEGREE;
+  auto x = [&](const LatLng& q) { return (q.lng - a.lng) * lng_scale; };
+  auto y = [&](const LatLng& q) { return (q.lat - a.lat) * METERS_PER_DEGREE; };
+
+  const double bx = x(b), by = y(b), px = x(p), py = y(p);
+  const double len = bx * bx + by * by;
+  double t = len > 0 ? (px * bx + py * by) / len : 0;
+  t = std::max(0.0, std::min(1.0, t));
+  return std::hypot(px - t * bx, py - t * by);
+}
+}
+
+TEST_CASE("Straight line is reduced to its end points")
+{
+  std::vector<LatLng> points;
+  for (int i = 0; i < 100; ++i) {
+    points.push_back(offset(0, i * 10.0));
+  }
+
+  auto kept = simplify_polyline(points, 1.0);
+  REQUIRE(kept.size() == 2);
+  REQUIRE(kept.front() == 0);
+  REQUIRE(kept.back() == 99);
+}
+
+TEST_CASE("Corners bigger than the tolerance are kept")
+{
+  std::vector<LatLng> points;
+  for (int i = 0; i <= 10; ++i) {
+    points.push_back(offset(0, i * 10.0));
+  }
+  for (int i = 1; i <= 10; ++i) {
+    points.push_back(offset(i * 10.0, 100));
+  }
+
+  auto kept = simplify_polyline(points, 1.0);
+  REQUIRE(kept == std::vector<size_t> { 0, 10, 20 });
+}
+
+TEST_CASE("No tolerance keeps every point")
+{
+  std::vector<LatLng> points { offset(0, 0), offset(0, 1), offset(0, 2) };
+  REQUIRE(simplify_polyline(points, 0).size() == 3);
+}
+
+TEST_CASE("Dropped points stay within tolerance of the simplified line")
+{
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> step(-15.0, 15.0);
+
+  std::vector<LatLng> points;
+  double north = 0;
+  double east = 0;
+  for (int i = 0; i < 2000; ++i) {
+    north += step(gen);
+    east += std::abs(step(gen));
+    points.push_back(offset(north, east));
+  }
+
+  const double tolerance = 20.0;
+  auto kept = simplify_polyline(points, tolerance);
+  REQUIRE(kept.size() < points.size());
+  for (size_t k = 1; k < kept.size(); ++k) {
+    REQUIRE(kept[k - 1] < kept[k]);
+    for (size_t i = kept[k - 1] + 1; i < kept[k]; ++i) {
+      REQUIRE(segment_distance(points[i], points[kept[k - 1]], points[kept[k]])
+          <= tolerance + 0.01);
+    }
+  }
+}
+
+TEST_CASE("Height profile stays within tolerance of the kept samples")
+{
+  std::vector<double> distances { 0, 10, 20, 20, 30, 40, 50 };
+  std::vector<double> heights { 100, 101, 102, 110, 111, 112, 112 };
+
+  auto kept = simplify_profile(distances, heights, 1.0);
+  REQUIRE(kept.front() == 0);
+  REQUIRE(kept.back() == 6);
+  // The jump at 20 m is kept on both sides.
+  REQUIRE(std::find(kept.begin(), kept.end(), 2) != kept.end());
+  REQUIRE(std::find(kept.begin(), kept.end(), 3) != kept.end());
+  REQUIRE(simplify_profile(distances, heights, 0).size() == heights.size());
+}
+
+TEST_CASE("Simplified routes send fewer geometry and profile samples")
+{
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> step(-15.0, 15.0);
+  std::uniform_real_distribution<double> climb(-0.5, 1.0);
+
+  std::vector<LatLng> points;
+  std::vector<double> distances;
+  std::vector<double> heights;
+  double north = 0;
+  double east = 0;
+  double height = 300;
+  double distance = 0;
+  for (int i = 0; i < 2000; ++i) {
+    const double dNorth = step(gen);
+    const double dEast = std::abs(step(gen));
+    north += dNorth;
+    east += dEast;
+    distance += std::hypot(dNorth, dEast);
+    height += climb(gen);
+    points.push_back(offset(north, east));
+    distances.push_back(distance);
+    heights.push_back(height);
+  }
+
+  // routeToJson sends the geometry and the profile, the latter with a tenth
+  // of the tolerance.
+  const double tolerance = 50.0;
+  auto keptPoints = simplify_polyline(points, tolerance);
+  auto keptSamples = simplify_profile(distances, heights, tolerance / 10);
+  REQUIRE(keptPoints.size() + keptSamples.size() < points.size() / 2);
+
+  for (size_t k = 1; k < keptSamples.size(); ++k) {
+    const auto a = keptSamples[k - 1];
+    const auto b = keptSamples[k];
+    REQUIRE(a < b);
+    for (size_t i = a + 1; i < b; ++i) {
+      const double t = (distances[i] - distances[a]) / (distances[b] - distances[a]);
+      const double interpolated = heights[a] + t * (heights[b] - heights[a]);
+      REQUIRE(std::abs(heights[i] - interpolated) <= tolerance / 10 + 1e-9);
+    }
+  }
+}
@@ -0,0 +1,129 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "contraction.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+TEST_CASE("Updated costs propagate to shortcuts")
+{
+  // A ring 0 - 1 - 2 - 3 - 4 - 5 - 0 in both directions.
+  std::string file { R"!!(# Build by: recustomization_test
+
+2
+6
+12
+0 100 48.000 9.000 300 0
+1 101 48.000 9.001 300 0
+2 102 48.001 9.002 300 0
+3 103 48.002 9.001 300 0
+4 104 48.002 9.000 300 0
+5 105 48.001 8.999 300 0
+0 1 10 1 -1 -1
+1 0 10 1 -1 -1
+1 2 10 1 -1 -1
+2 1 10 1 -1 -1
+2 3 10 1 -1 -1
+3 2 10 1 -1 -1
+3 4 10 1 -1 -1
+4 3 10 1 -1 -1
+4 5 10 1 -1 -1
+5 4 10 1 -1 -1
+5 0 10 1 -1 -1
+0 5 10 1 -1 -1
+)!!" };
+
+  std::istringstream uncontracted { file };
+  auto contraction = Contraction<2>::createFromStream(uncontracted);
+  contraction.contract(ContractionOptions {});
+  REQUIRE(contraction.getShortcutCount() > 0);
+  std::stringstream contracted;
+  contraction.writeText(contracted);
+  auto g = Graph<2>::createFromStream(contracted);
+  const auto& edges = g.getEdges();
+
+  EdgeId first { std::numeric_limits<uint32_t>::max() };
+  for (uint32_t i = 0; i < g.getNodeCount(); ++i) {
+    for (const auto& edge : g.getOutgoingEdgesOf(NodePos { i })) {
+      if (edge.id < first) {
+        first = edge.id;
+      }
+    }
+  }
+  size_t originalCount = 0;
+  for (uint32_t i = 0; i < g.getNodeCount(); ++i) {
+    for (const auto& edge : g.getOutgoingOriginalEdgesOf(NodePos { i })) {
+      REQUIRE_FALSE(edges.getEdgeA(edge.id));
+      ++originalCount;
+    }
+  }
+  REQUIRE(originalCount == 12);
+
+  // The first edge of the file is 0 -> 1, make it more expensive in one
+  // criterion and cheaper in the other.
+  const Cost<2> newCost { std::vector<double> { 20, 0.5 } };
+  auto result = g.updateCosts({ CostUpdate<2> { first, newCost } }, 2);
+  REQUIRE(result.updatedEdges == 1);
+  REQUIRE(result.updatedShortcuts > 0);
+  REQUIRE(result.flagged.size() == result.updatedShortcuts + 1);
+  REQUIRE(edges.getCost(first) == newCost);
+
+  for (uint32_t i = 0; i < g.getNodeCount(); ++i) {
+    for (const auto& edge : g.getOutgoingEdgesOf(NodePos { i })) {
+      REQUIRE(edge.cost == edges.getCost(edge.id));
+      const auto& edgeA = edges.getEdgeA(edge.id);
+      if (edgeA) {
+        const auto& edgeB = *edges.getEdgeB(edge.id);
+        REQUIRE(edge.cost == edges.getCost(*edgeA) + edges.getCost(edgeB));
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < g.getNodeCount(); ++i) {
+    for (const auto& edge : g.getIngoingOriginalEdgesOf(NodePos { i })) {
+      REQUIRE(edge.cost == edges.getCost(edge.id));
+    }
+  }
+
+  auto d = g.createDijkstra();
+  Config<2> config { std::vector<double> { 1, 0 } };
+  auto route = d.findBestRoute(
+      *g.nodePosById(NodeId { 0 }), *g.nodePosById(NodeId { 2 }), config);
+  REQUIRE(route);
+  REQUIRE(route->costs * config == Approx(30));
+
+  REQUIRE_THROWS(g.updateCosts({ CostUpdate<2> { EdgeId { first + 100 }, newCost } }));
+
+  // Cheaper edges are flagged unless both nodes have the same level.
+  std::vector<std::pair<EdgeId, bool>> originals;
+  for (uint32_t i = 0; i < g.getNodeCount(); ++i) {
+    for (const auto& edge : g.getOutgoingOriginalEdgesOf(NodePos { i })) {
+      originals.emplace_back(edge.id, g.getLevelOf(NodePos { i }) != g.getLevelOf(edge.end));
+    }
+  }
+  REQUIRE(std::any_of(
+      originals.begin(), originals.end(), [](const auto& original) { return original.second; }));
+  for (const auto& [id, crossesLevels] : originals) {
+    auto cheaper = edges.getCost(id);
+    cheaper.values[1] /= 2;
+    auto cheaperResult = g.updateCosts({ CostUpdate<2> { id, cheaper } });
+    const auto& flagged = cheaperResult.flagged;
+    REQUIRE((std::find(flagged.begin(), flagged.end(), id) != flagged.end()) == crossesLevels);
+  }
+}
@@ -0,0 +1,162 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "compute_executor.hpp"
+#include "route_batch.hpp"
+
+#include <future>
+#include <thread>
+
+TEST_CASE("Route batch answers all queries in order")
+{
+  std::string file { R"!!(# Type : chgraph
+# Id : f5c398be8e451b8fe2b170dca6a87563
+# Revision : 1
+# Timestamp : 1493032504
+# Origin : ch_constructor
+# OriginId : 0
+# OriginRevision : 1
+# OriginTimestamp : 1491925284
+# OriginType : maxspeed
+
+3
+3
+2
+0 470552 49.3413737 7.3014905 0 0
+1 470553 49.3407609 7.3007752 0 0
+2 470554 49.3405748 7.3002951 0 0
+0 1 85 2 70 -1 -1
+1 2 16 2 70 -1 -1
+
+)!!" };
+  using Config = Config<3>;
+
+  auto iss = std::istringstream(file);
+  auto g = Graph<3>::createFromStream(iss);
+  auto grid = g.createGrid();
+
+  Config c { LengthConfig { 1.0 }, HeightConfig { 0 }, UnsuitabilityConfig { 0 } };
+  std::vector<BatchQuery<3>> queries;
+  for (size_t i = 0; i < 20; ++i) {
+    queries.push_back(BatchQuery<3> { NodePos { 0 }, NodePos { 2 }, {}, {}, c });
+    queries.push_back(BatchQuery<3> { NodePos { 2 }, NodePos { 0 }, {}, {}, c });
+  }
+  queries.push_back(BatchQuery<3> { {}, {}, LatLng { Lat { 49.3413 }, Lng { 7.3015 } },
+      LatLng { Lat { 49.3407 }, Lng { 7.3007 } }, c });
+
+  RouteBatch<3> batch { std::move(queries) };
+
+  std::vector<Dijkstra<3>> dijkstras;
+  dijkstras.push_back(g.createDijkstra());
+  dijkstras.push_back(g.createDijkstra());
+
+  bool firstFinished = false;
+  bool secondFinished = false;
+  std::thread helper { [&]() { secondFinished = batch.work(dijkstras[1], grid); } };
+  firstFinished = batch.work(dijkstras[0], grid);
+  helper.join();
+
+  REQUIRE(firstFinished != secondFinished);
+
+  const auto& results = batch.get_results();
+  REQUIRE(results.size() == 41);
+  for (size_t i = 0; i < 40; i += 2) {
+    REQUIRE(results[i].route);
+    REQUIRE(results[i].route->costs.values[0] == 101);
+    REQUIRE_FALSE(results[i + 1].route);
+    REQUIRE(results[i + 1].error == "Did not find route");
+  }
+  REQUIRE(results[40].route);
+  REQUIRE(results[40].route->costs.values[0] == 85);
+}
+
+TEST_CASE("Large route batches leave a worker for single queries")
+{
+  std::string file { R"!!(# Type : chgraph
+# Id : f5c398be8e451b8fe2b170dca6a87563
+# Revision : 1
+# Timestamp : 1493032504
+# Origin : ch_constructor
+# OriginId : 0
+# OriginRevision : 1
+# OriginTimestamp : 1491925284
+# OriginType : maxspeed
+
+3
+2
+1
+0 470552 49.3413737 7.3014905 0 0
+1 470553 49.3407609 7.3007752 0 0
+0 1 85 2 70 -1 -1
+
+)!!" };
+  using Config = Config<3>;
+
+  auto iss = std::istringstream(file);
+  auto g = Graph<3>::createFromStream(iss);
+  auto grid = g.createGrid();
+
+  const size_t workers = 4;
+  const size_t maxBatchJobs = 2;
+  REQUIRE(batch_helpers(1000, workers, maxBatchJobs) == 1);
+  REQUIRE(batch_helpers(1000, workers, 1) == 3);
+  REQUIRE(batch_helpers(2, 8, 1) == 2);
+  REQUIRE(batch_helpers(1000, 1, 1) == 1);
+
+  std::vector<Dijkstra<3>> dijkstras;
+  for (size_t i = 0; i < workers; ++i) {
+    dijkstras.push_back(g.createDijkstra());
+  }
+
+  Config c { LengthConfig { 1.0 }, HeightConfig { 0 }, UnsuitabilityConfig { 0 } };
+  auto batchFor = [&c]() {
+    std::vector<BatchQuery<3>> queries(
+        1000, BatchQuery<3> { NodePos { 0 }, NodePos { 1 }, {}, {}, c });
+    return std::make_shared<RouteBatch<3>>(std::move(queries));
+  };
+
+  // Both admitted batches hold their helpers until the single query is answered.
+  std::promise<void> unblock;
+  auto blocked = unblock.get_future().share();
+  auto waitForSingle = [blocked](const Dijkstra<3>&) { blocked.wait(); };
+  ComputeExecutor executor { workers, 100 };
+  std::vector<std::shared_ptr<RouteBatch<3>>> batches { batchFor(), batchFor() };
+  std::atomic<size_t> finished { 0 };
+  for (auto& batch : batches) {
+    for (size_t i = 0; i < batch_helpers(batch->size(), workers, maxBatchJobs); ++i) {
+      REQUIRE(executor.try_submit([&, batch](size_t worker) {
+        if (batch->work(dijkstras[worker], grid, waitForSingle)) {
+          ++finished;
+        }
+      }));
+    }
+  }
+
+  std::promise<bool> single;
+  auto answered = single.get_future();
+  REQUIRE(executor.try_submit([&](size_t worker) {
+    single.set_value(dijkstras[worker].findBestRoute(NodePos { 0 }, NodePos { 1 }, c).has_value());
+  }));
+  REQUIRE(answered.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+  REQUIRE(answered.get());
+
+  unblock.set_value();
+  while (finished < batches.size()) {
+    std::this_thread::yield();
+  }
+}
@@ -0,0 +1,272 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2018  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "segment_index.hpp"
+
+#include "dijkstra.hpp"
+#include "graph.hpp"
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <random>
+#include <sstream>
+
+namespace {
+Graph<3> lineGraph()
+{
+  // 0 <-> 1 -> 2 along the equator, the segments are about 1.1km long.
+  std::string file { R"!!(# Type : chgraph
+
+3
+3
+3
+0 0 0.0 0.0 0 0
+1 1 0.0 0.01 0 0
+2 2 0.0 0.02 0 0
+0 1 100 0 0 -1 -1
+1 0 100 0 0 -1 -1
+1 2 50 0 0 -1 -1
+
+)!!" };
+  auto iss = std::istringstream(file);
+  return Graph<3>::createFromStream(iss);
+}
+}
+
+TEST_CASE("Empty segment index finds nothing")
+{
+  std::vector<Node> nodes {};
+  SegmentIndex index { nodes, {} };
+  REQUIRE_FALSE(index.findNextSegment(Lat { 48.5 }, Lng { 8.3 }));
+}
+
+TEST_CASE("Snapping projects onto the segment")
+{
+  auto g = lineGraph();
+  auto index = g.createSegmentIndex();
+  REQUIRE(index.size() == 3);
+
+  auto snapped = index.findNextSegment(Lat { 0.001 }, Lng { 0.0025 });
+  REQUIRE(snapped);
+  REQUIRE(((snapped->source == NodePos { 0 }) || (snapped->source == NodePos { 1 })));
+  const double fraction = snapped->source == NodePos { 0 } ? 0.25 : 0.75;
+  REQUIRE(snapped->fraction == Approx(fraction));
+  REQUIRE(snapped->point.lat.get() == Approx(0.0).margin(1e-9));
+  REQUIRE(snapped->point.lng.get() == Approx(0.0025));
+  REQUIRE(snapped->distance == Approx(111.2).epsilon(0.01));
+
+  // Beyond the end of the road the projection is clamped to the last node.
+  snapped = index.findNextSegment(Lat { 0.0 }, Lng { 0.03 });
+  REQUIRE(snapped);
+  REQUIRE(snapped->source == NodePos { 1 });
+  REQUIRE(snapped->target == NodePos { 2 });
+  REQUIRE(snapped->fraction == Approx(1.0));
+  REQUIRE(snapped->point.lng.get() == Approx(0.02));
+}
+
+TEST_CASE("Find next segment agrees with brute force search")
+{
+  std::mt19937 gen { 42 };
+  std::normal_distribution<double> cityDist { 0.0, 0.01 };
+  std::uniform_int_distribution<uint32_t> nodeDist { 0, 1999 };
+
+  std::vector<Node> nodes {};
+  for (uint32_t i = 0; i < 2000; ++i) {
+    nodes.emplace_back(
+        NodeId { i }, Lat { 48.77 + cityDist(gen) }, Lng { 9.18 + cityDist(gen) }, 0);
+  }
+  std::vector<Segment> segments;
+  for (uint32_t i = 0; i < 5000; ++i) {
+    segments.push_back(
+        Segment { EdgeId { i }, NodePos { nodeDist(gen) }, NodePos { nodeDist(gen) } });
+  }
+
+  SegmentIndex index { nodes, segments };
+
+  auto chordDistance = [&nodes](const Segment& s, const std::array<double, 3>& q) {
+    const auto& source = nodes[s.source];
+    const auto& target = nodes[s.target];
+    auto a = unit_vector(source.lat(), source.lng());
+    auto b = unit_vector(target.lat(), target.lng());
+    double best = std::numeric_limits<double>::max();
+    // Sampling the segment densely is good enough as a reference.
+    for (size_t step = 0; step <= 1000; ++step) {
+      const double t = step / 1000.0;
+      double dist = 0;
+      for (size_t d = 0; d < 3; ++d) {
+        const double delta = a[d] + t * (b[d] - a[d]) - q[d];
+        dist += delta * delta;
+      }
+      best = std::min(best, dist);
+    }
+    return std::sqrt(best);
+  };
+
+  for (size_t q = 0; q < 100; ++q) {
+    Lat lat { 48.77 + cityDist(gen) };
+    Lng lng { 9.18 + cityDist(gen) };
+    auto target = unit_vector(lat, lng);
+
+    double bestDist = std::numeric_limits<double>::max();
+    for (const auto& segment : segments) {
+      bestDist = std::min(bestDist, chordDistance(segment, target));
+    }
+
+    auto snapped = index.findNextSegment(lat, lng);
+    REQUIRE(snapped);
+    const double EARTH_RADIUS = 6371007.2;
+    REQUIRE(snapped->distance <= bestDist * EARTH_RADIUS + 0.01);
+    REQUIRE(snapped->distance >= bestDist * EARTH_RADIUS - 1.0);
+  }
+}
+
+TEST_CASE("Segment index survives a binary archive")
+{
+  auto g = lineGraph();
+  const auto& index = g.getSegmentIndex();
+  REQUIRE(&index == &g.getSegmentIndex());
+
+  std::stringstream binary;
+  {
+    boost::archive::binary_oarchive out { binary };
+    out << index;
+  }
+  SegmentIndex loaded { std::vector<Node> {}, {} };
+  boost::archive::binary_iarchive in { binary };
+  in >> loaded;
+
+  REQUIRE(loaded.size() == index.size());
+  for (double lng : { -0.01, 0.0025, 0.011, 0.019, 0.03 }) {
+    auto expected = index.findNextSegment(Lat { 0.001 }, Lng { lng });
+    auto snapped = loaded.findNextSegment(Lat { 0.001 }, Lng { lng });
+    REQUIRE(snapped);
+    REQUIRE(snapped->edge == expected->edge);
+    REQUIRE(snapped->fraction == expected->fraction);
+    REQUIRE(snapped->distance == expected->distance);
+  }
+}
+
+namespace {
+// Writes the fields of a SegmentIndex in its archive layout, with leaf ranges
+// beyond the stored segments like a truncated file.
+struct StaleSegmentIndex {
+  template <class Archive> void serialize(Archive& ar, const unsigned int /*version*/)
+  {
+    std::vector<uint32_t> segments { 0, 0, 1 };
+    std::vector<double> values { 1.0 };
+    std::vector<double> bounds(6, 0.0);
+    std::vector<uint32_t> ranges { 0, 2 };
+    size_t leafLevel = 0;
+    ar& segments;
+    for (size_t d = 0; d < 3; ++d) {
+      ar& values;
+      ar& values;
+    }
+    ar& values;
+    ar& bounds;
+    ar& ranges;
+    ar& leafLevel;
+  }
+};
+}
+
+TEST_CASE("Segment index rejects stale archives")
+{
+  std::stringstream binary;
+  {
+    boost::archive::binary_oarchive out { binary };
+    const StaleSegmentIndex stale {};
+    out << stale;
+  }
+  SegmentIndex loaded { std::vector<Node> {}, {} };
+  boost::archive::binary_iarchive in { binary };
+  REQUIRE_THROWS_AS(in >> loaded, std::runtime_error);
+
+  auto g = lineGraph();
+  const auto& index = g.getSegmentIndex();
+  REQUIRE(index.fits(3, 3));
+  REQUIRE_FALSE(index.fits(2, 3));
+  REQUIRE_FALSE(index.fits(3, 2));
+}
+
+TEST_CASE("Route between snapped points")
+{
+  auto g = lineGraph();
+  auto index = g.createSegmentIndex();
+  auto d = g.createDijkstra();
+  Config<3> c { LengthConfig { 1.0 }, HeightConfig { 0 }, UnsuitabilityConfig { 0 } };
+
+  auto snap = [&index](double lng) {
+    return *index.findNextSegment(Lat { 0.0001 }, Lng { lng });
+  };
+  // Routes are compared by their nodes.
+  auto nodesOf = [&g](const Route<3>& route) {
+    const auto& edges = g.getEdges();
+    std::vector<NodePos> nodes { edges.sourcePos(route.edges.front()) };
+    for (const auto& edge : route.edges) {
+      nodes.push_back(edges.destPos(edge));
+    }
+    return nodes;
+  };
+  auto path = [](std::vector<uint32_t> nodes) {
+    return std::vector<NodePos>(nodes.begin(), nodes.end());
+  };
+
+  SECTION("Across a node")
+  {
+    auto route = d.findBestRoute(snap(0.0025), snap(0.015), c);
+    REQUIRE(route);
+    REQUIRE(route->costs.values[0] == Approx(75 + 25));
+    REQUIRE(nodesOf(*route) == path({ 0, 1, 2 }));
+  }
+
+  SECTION("Against a one way street")
+  {
+    REQUIRE_FALSE(d.findBestRoute(snap(0.015), snap(0.0025), c));
+    REQUIRE_FALSE(d.findBestRoute(snap(0.019), snap(0.011), c));
+  }
+
+  SECTION("On the same edge")
+  {
+    auto route = d.findBestRoute(snap(0.011), snap(0.019), c);
+    REQUIRE(route);
+    REQUIRE(route->costs.values[0] == Approx(40));
+    REQUIRE(nodesOf(*route) == path({ 1, 2 }));
+  }
+
+  SECTION("Both directions of a two way street")
+  {
+    auto forward = d.findBestRoute(snap(0.0025), snap(0.0075), c);
+    REQUIRE(forward);
+    REQUIRE(forward->costs.values[0] == Approx(50));
+    REQUIRE(nodesOf(*forward) == path({ 0, 1 }));
+
+    auto backward = d.findBestRoute(snap(0.0075), snap(0.0025), c);
+    REQUIRE(backward);
+    REQUIRE(backward->costs.values[0] == Approx(50));
+    REQUIRE(nodesOf(*backward) == path({ 1, 0 }));
+  }
+
+  SECTION("Node queries are unchanged")
+  {
+    auto route = d.findBestRoute(NodePos { 0 }, NodePos { 2 }, c);
+    REQUIRE(route);
+    REQUIRE(route->costs.values[0] == 150);
+    REQUIRE(nodesOf(*route) == path({ 0, 1, 2 }));
+  }
+}
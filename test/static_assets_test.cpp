@@ -0,0 +1,115 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "catch.hpp"
+#include "static_assets.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <fstream>
+#include <sstream>
+
+namespace fs = boost::filesystem;
+
+TEST_CASE("Static assets are served from memory")
+{
+  auto root = fs::temp_directory_path() / fs::unique_path();
+  fs::create_directories(root / "leaflet");
+  {
+    std::ofstream index { (root / "index.html").string() };
+    index << "<html></html>";
+    std::ofstream script { (root / "leaflet" / "leaflet.js").string() };
+    for (int i = 0; i < 100; ++i) {
+      script << "var leaflet = 'compresses well';\n";
+    }
+  }
+
+  StaticAssets assets { root.string() };
+  fs::remove_all(root);
+
+  SECTION("Directories resolve to their index.html")
+  {
+    REQUIRE(assets.find("") != nullptr);
+    REQUIRE(assets.find("/")->etag == assets.find("index.html")->etag);
+    REQUIRE(assets.find("/")->body == "<html></html>");
+    REQUIRE(assets.find("/")->contentType == "text/html; charset=utf-8");
+    REQUIRE(assets.find("/leaflet") == nullptr);
+  }
+
+  SECTION("Files outside the web root are never found")
+  {
+    REQUIRE(assets.find("../index.html") == nullptr);
+    REQUIRE(assets.find("/etc/passwd") == nullptr);
+  }
+
+  SECTION("Compressed body decompresses to the original")
+  {
+    auto script = assets.find("/leaflet/leaflet.js/");
+    REQUIRE(script != nullptr);
+    REQUIRE(!script->gzipBody.empty());
+    REQUIRE(script->gzipBody.size() < script->body.size());
+
+    std::istringstream compressed { script->gzipBody };
+    boost::iostreams::filtering_istream in;
+    in.push(boost::iostreams::gzip_decompressor());
+    in.push(compressed);
+    std::ostringstream plain;
+    plain << in.rdbuf();
+    REQUIRE(plain.str() == script->body);
+  }
+
+  SECTION("ETags differ for different content")
+  {
+    REQUIRE(assets.find("index.html")->etag != assets.find("leaflet/leaflet.js")->etag);
+  }
+
+  SECTION("Compressed and plain bodies have their own ETag")
+  {
+    auto script = assets.find("leaflet/leaflet.js");
+    REQUIRE(!script->gzipEtag.empty());
+    REQUIRE(script->gzipEtag != script->etag);
+    REQUIRE(assets.find("index.html")->gzipEtag.empty());
+  }
+}
+
+TEST_CASE("If-None-Match header parsing")
+{
+  REQUIRE(etag_matches("\"abc\"", "\"abc\""));
+  REQUIRE(etag_matches("\"x\", W/\"abc\"", "\"abc\""));
+  REQUIRE(etag_matches("*", "\"abc\""));
+  REQUIRE_FALSE(etag_matches("\"abcd\"", "\"abc\""));
+  REQUIRE_FALSE(etag_matches("", "\"abc\""));
+}
+
+TEST_CASE("Accept-Encoding header parsing")
+{
+  REQUIRE(accepts_gzip("gzip, deflate, br"));
+  REQUIRE(accepts_gzip("deflate, gzip;q=0.5"));
+  REQUIRE(accepts_gzip("*"));
+  REQUIRE_FALSE(accepts_gzip("gzip;q=0"));
+  REQUIRE_FALSE(accepts_gzip("deflate, br"));
+  REQUIRE_FALSE(accepts_gzip(""));
+  REQUIRE_FALSE(accepts_gzip("gzip;q=abc"));
+  REQUIRE_FALSE(accepts_gzip("gzip;q="));
+  REQUIRE_FALSE(accepts_gzip("gzip;q=0.5x"));
+  REQUIRE_FALSE(accepts_gzip("*;q=1, gzip;q=0"));
+  REQUIRE(accepts_gzip("gzip;q=0.5, *;q=0"));
+  REQUIRE(accepts_gzip("GZIP"));
+  REQUIRE_FALSE(accepts_gzip("Gzip;q=0, *"));
+}
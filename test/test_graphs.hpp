@@ -0,0 +1,73 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef TEST_GRAPHS_H
+#define TEST_GRAPHS_H
+
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+
+// Text file of a width x height grid graph. Every street has an edge to the
+// right or downwards, oneWayShare of them have no edge back. Costs are drawn
+// from [1, maxCost] in each of dim dimensions. Node ids equal positions.
+inline std::string gridGraphText(size_t width, size_t height, uint32_t seed,
+    double oneWayShare = 0.0, uint32_t maxCost = 99, size_t dim = 3)
+{
+  std::mt19937 gen { seed };
+  std::uniform_int_distribution<uint32_t> cost { 1, maxCost };
+  std::bernoulli_distribution oneWay { oneWayShare };
+  std::stringstream nodes;
+  std::stringstream edges;
+  size_t edgeCount = 0;
+  auto addEdge = [&](size_t from, size_t to) {
+    edges << from << ' ' << to;
+    for (size_t i = 0; i < dim; ++i) {
+      edges << ' ' << cost(gen);
+    }
+    edges << " -1 -1" << '\n';
+    ++edgeCount;
+  };
+  auto addStreet = [&](size_t from, size_t to) {
+    addEdge(from, to);
+    if (!oneWay(gen)) {
+      addEdge(to, from);
+    }
+  };
+  const size_t nodeCount = width * height;
+  for (size_t i = 0; i < nodeCount; ++i) {
+    nodes << i << ' ' << i << ' ' << 48.0 + (i / width) * 0.001 << ' '
+          << 9.0 + (i % width) * 0.001 << " 300 0" << '\n';
+    if (i % width + 1 < width) {
+      addStreet(i, i + 1);
+    }
+    if (i + width < nodeCount) {
+      addStreet(i, i + width);
+    }
+  }
+  std::stringstream file;
+  file << "# Build by: gridGraphText" << '\n'
+       << '\n'
+       << dim << '\n'
+       << nodeCount << '\n'
+       << edgeCount << '\n'
+       << nodes.str() << edges.str();
+  return file.str();
+}
+
+#endif /* TEST_GRAPHS_H */
@@ -0,0 +1,73 @@
+/*
+  Cycle-routing does multi-criteria route planning for bicycles.
+  Copyright (C) 2019  Florian Barth
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "catch.hpp"
+#include "trace.hpp"
+
+#include <thread>
+
+TEST_CASE("Trace records typed fields and nested spans")
+{
+  auto mark = Trace::mark();
+  {
+    TraceSpan outer { "outer", { TraceField { "s", 3u } } };
+    Trace::event("inner", { TraceField { "delta", -2 }, TraceField { "kind", "test" } });
+    outer.field("ratio", 0.5);
+  }
+
+  auto events = Trace::since(mark);
+  REQUIRE(events.size() == 2);
+  REQUIRE(std::string(events[0].name) == "outer");
+  REQUIRE_FALSE(events[0].instant);
+  REQUIRE(events[0].fieldCount == 2);
+  REQUIRE(events[0].fields[0].type == TraceField::Type::UInt);
+  REQUIRE(events[0].fields[0].u == 3);
+  REQUIRE(events[0].fields[1].type == TraceField::Type::Double);
+  REQUIRE(std::string(events[1].name) == "inner");
+  REQUIRE(events[1].instant);
+  REQUIRE(events[1].fields[0].i == -2);
+  REQUIRE(events[1].start >= events[0].start);
+  REQUIRE(events[1].start <= events[0].start + events[0].duration);
+
+  auto text = Trace::to_text(events);
+  REQUIRE(text.find(" outer ") != std::string::npos);
+  REQUIRE(text.find("s=3 ratio=0.5") != std::string::npos);
+  REQUIRE(text.find("   inner delta=-2 kind=test") != std::string::npos);
+}
+
+TEST_CASE("Trace ring buffer keeps the newest events")
+{
+  auto mark = Trace::mark();
+  for (size_t i = 0; i < Trace::CAPACITY + 10; ++i) {
+    Trace::event("tick", { TraceField { "i", i } });
+  }
+
+  size_t dropped = 0;
+  auto events = Trace::since(mark, &dropped);
+  REQUIRE(dropped == 10);
+  REQUIRE(events.size() == Trace::CAPACITY);
+  REQUIRE(events.front().fields[0].u == 10);
+  REQUIRE(events.back().fields[0].u == Trace::CAPACITY + 9);
+}
+
+TEST_CASE("Trace buffers are per thread")
+{
+  auto mark = Trace::mark();
+  std::thread other { []() { Trace::event("other"); } };
+  other.join();
+  REQUIRE(Trace::since(mark).empty());
+}
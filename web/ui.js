@@ -3,6 +3,10 @@ var map = L.map("mapid", { closePopupOnClick: false }).setView(
   13
 );
 var start = true;
+// Routes are requested between the clicked points, which the server snaps onto
+// the closest road.
+var startLatLng = null;
+var endLatLng = null;
 
 var startPopup = L.popup({ autoClose: false });
 var endPopup = L.popup({ autoClose: false });
@@ -43,6 +47,7 @@ function onMapClick(e) {
     .setLatLng(e.latlng)
     .setContent("Start at " + e.latlng.toString())
     .addTo(map);
+  startLatLng = e.latlng;
   getNode(id, e.latlng);
 }
 
@@ -52,6 +57,7 @@ function onRightClick(e) {
     .setLatLng(e.latlng)
     .setContent("End at " + e.latlng.toString())
     .addTo(map);
+  endLatLng = e.latlng;
   getNode(id, e.latlng);
 }
 
@@ -108,20 +114,35 @@ function calcDist(length, height, unsuitability) {
       document.getElementById("route_unsuitability").innerHTML = "Unknown";
     }
   };
-  let s = document.getElementById("start").innerHTML;
-  let t = document.getElementById("end").innerHTML;
+  let endpoints;
+  if (startLatLng && endLatLng) {
+    endpoints =
+      "s_lat=" +
+      startLatLng.lat +
+      "&s_lng=" +
+      startLatLng.lng +
+      "&t_lat=" +
+      endLatLng.lat +
+      "&t_lng=" +
+      endLatLng.lng;
+  } else {
+    let s = document.getElementById("start").innerHTML;
+    let t = document.getElementById("end").innerHTML;
+    endpoints = "s=" + s + "&t=" + t;
+  }
   xmlhttp.open(
     "GET",
-    "/route?s=" +
-      s +
-      "&t=" +
-      t +
+    "/route?" +
+      endpoints +
       "&length=" +
       length +
       "&height=" +
       height +
       "&unsuitability=" +
-      unsuitability,
+      unsuitability +
+      "&zoom=" +
+      map.getZoom() +
+      debugParameter(),
     true
   );
   xmlhttp.send();
@@ -329,6 +350,12 @@ function configToCoords(values) {
   };
 }
 
+// The server only writes its debug log while the log is shown
+function debugParameter() {
+  let debugLog = document.getElementById("debuglog");
+  return debugLog.hasAttribute("hidden") ? "" : "&debug=1";
+}
+
 function addToDebugLog(requestType, message) {
   if (!message) {
     return;
@@ -391,20 +418,45 @@ let heightMarker;
 function createHeightChart(json, layer) {
   layer.bindPopup("I have a height chart attached");
   let coords = json.geometry.coordinates;
+  let profile = json.properties && json.properties.heights;
 
   if (myLineChart.destroy) myLineChart.destroy();
   heightValues = [];
   labels = [];
   let dist = 0;
+  let coordDists = [];
   for (let c in coords) {
     if (c > 0) {
       let node = L.latLng(coords[c][1], coords[c][0]);
       let lastNode = L.latLng(coords[c - 1][1], coords[c - 1][0]);
       dist += lastNode.distanceTo(node);
     }
-    labels.push(Math.round(dist * 10) / 10);
-    heightValues.push(coords[c][2]);
+    coordDists.push(dist);
+    if (!profile) {
+      labels.push(Math.round(dist * 10) / 10);
+      heightValues.push(coords[c][2]);
+    }
   }
+  if (profile) {
+    // simplified geometry, the height profile is sent separately
+    for (let sample of profile) {
+      labels.push(Math.round(sample[0] * 10) / 10);
+      heightValues.push(sample[1]);
+    }
+  }
+
+  let coordAt = function(index) {
+    if (!profile) {
+      return coords[index];
+    }
+    let profileLength = profile[profile.length - 1][0] || 1;
+    let target = profile[index][0] * (dist / profileLength);
+    let c = 0;
+    while (c < coords.length - 1 && coordDists[c + 1] <= target) {
+      c++;
+    }
+    return coords[c];
+  };
 
   let ctx = document.getElementById("heightChart").getContext("2d");
   myLineChart = new Chart(ctx, {
@@ -427,7 +479,8 @@ function createHeightChart(json, layer) {
         if (points.length > 0) {
           let index = points[0]._index;
 
-          let ll = L.latLng(coords[index][1], coords[index][0]);
+          let coord = coordAt(index);
+          let ll = L.latLng(coord[1], coord[0]);
           if (heightMarker) {
             heightMarker.setLatLng(ll);
           } else {
@@ -506,7 +559,10 @@ function enumerateRoutes() {
     "&maxOverlap=" +
     maxOverlap +
     "&important=" +
-    important;
+    important +
+    "&zoom=" +
+    map.getZoom() +
+    debugParameter();
 
   xmlhttp.open("GET", uri);
   xmlhttp.send();